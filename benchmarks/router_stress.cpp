@@ -0,0 +1,208 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "synthetic_network.h"
+#include "transport_router.h"
+
+using namespace std;
+
+// Нагрузочная проверка общего маршрутизатора: запросы Route вперемешку с BuildRoutes, Matrix и Isochrone
+// выполняются на 1/2/4/8 потоках над одним TransportCatalogueRouter для каждого движка, с кэшем ответов
+// и без него, с целочисленными весами и без них. Все ответы сверяются с ответами, полученными в одном потоке,
+// печатается пропускная способность. Запуск: router_stress [stop_count bus_count query_count]
+namespace {
+
+constexpr double EPSILON = 1e-9;
+constexpr size_t MATRIX_PERIOD = 50;
+constexpr size_t ROUTES_PERIOD = 7;
+constexpr double ISOCHRONE_MAX_TIME = 20;
+
+using Query = pair<string_view, string_view>;
+
+bool AreRoutesIdentical(const optional<request::StatRouteInfo> &lhs, const optional<request::StatRouteInfo> &rhs) {
+    if (lhs.has_value() != rhs.has_value()) {
+        return false;
+    }
+    if (!lhs) {
+        return true;
+    }
+    if (abs(lhs->weight - rhs->weight) > EPSILON || lhs->route.size() != rhs->route.size()) {
+        return false;
+    }
+    for (size_t index = 0; index < lhs->route.size(); ++index) {
+        const request::Route &lhs_item = lhs->route[index];
+        const request::Route &rhs_item = rhs->route[index];
+        if (lhs_item.is_wait != rhs_item.is_wait || lhs_item.stop != rhs_item.stop || lhs_item.bus != rhs_item.bus
+            || lhs_item.span_count != rhs_item.span_count || abs(lhs_item.weight - rhs_item.weight) > EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AreReachableStopsIdentical(const optional<vector<request::ReachableStop>> &lhs,
+                                const optional<vector<request::ReachableStop>> &rhs) {
+    if (lhs.has_value() != rhs.has_value() || (lhs && lhs->size() != rhs->size())) {
+        return false;
+    }
+    for (size_t index = 0; lhs && index < lhs->size(); ++index) {
+        if ((*lhs)[index].stop != (*rhs)[index].stop || abs((*lhs)[index].weight - (*rhs)[index].weight) > EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ответы одного потока, с которыми сверяются ответы многопоточного прогона
+struct ReferenceAnswers {
+    vector<optional<request::StatRouteInfo>> routes;
+    vector<optional<vector<request::ReachableStop>>> isochrones;
+};
+
+ReferenceAnswers MakeReferenceAnswers(const router::TransportCatalogueRouter &router, const vector<Query> &queries) {
+    ReferenceAnswers answers;
+    answers.routes.reserve(queries.size());
+    answers.isochrones.resize(queries.size());
+    for (size_t index = 0; index < queries.size(); ++index) {
+        answers.routes.push_back(router.BuildRoute(queries[index].first, queries[index].second));
+        if (index % MATRIX_PERIOD == 0) {
+            answers.isochrones[index] = router.BuildIsochrone(queries[index].first, ISOCHRONE_MAX_TIME);
+        }
+    }
+    return answers;
+}
+
+// Ответ на запрос index и сопутствующие запросы; возвращает число расхождений с эталоном
+size_t CheckQuery(const router::TransportCatalogueRouter &router, const vector<Query> &queries,
+                  const ReferenceAnswers &reference, size_t index) {
+    const auto &[from, to] = queries[index];
+    size_t mismatch_count = AreRoutesIdentical(router.BuildRoute(from, to), reference.routes[index]) ? 0 : 1;
+    if (index % ROUTES_PERIOD == 0) {
+        const size_t next_index = (index + 1) % queries.size();
+        const auto routes = router.BuildRoutes(from, {to, queries[next_index].second});
+        if (!AreRoutesIdentical(routes[0], reference.routes[index])) {
+            ++mismatch_count;
+        }
+        if (queries[next_index].first == from && !AreRoutesIdentical(routes[1], reference.routes[next_index])) {
+            ++mismatch_count;
+        }
+    }
+    if (index % MATRIX_PERIOD == 0) {
+        const auto matrix = router.BuildMatrix({from}, {to});
+        const auto &route = reference.routes[index];
+        if (matrix[0].has_value() != route.has_value() || (route && abs(*matrix[0] - route->weight) > 1e-6)) {
+            ++mismatch_count;
+        }
+        if (!AreReachableStopsIdentical(router.BuildIsochrone(from, ISOCHRONE_MAX_TIME), reference.isochrones[index])) {
+            ++mismatch_count;
+        }
+    }
+    return mismatch_count;
+}
+
+// Прогон всех запросов на thread_count потоках; возвращает время в миллисекундах и число расхождений
+pair<double, size_t> RunQueries(const router::TransportCatalogueRouter &router, const vector<Query> &queries,
+                                const ReferenceAnswers &reference, size_t thread_count) {
+    atomic<size_t> next_index = 0;
+    atomic<size_t> mismatch_count = 0;
+    const auto run = [&] {
+        for (size_t index = next_index++; index < queries.size(); index = next_index++) {
+            mismatch_count += CheckQuery(router, queries, reference, index);
+        }
+    };
+    const auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    workers.reserve(thread_count - 1);
+    for (size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+        workers.emplace_back(run);
+    }
+    run();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return {chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(), mismatch_count.load()};
+}
+
+const char *GetEngineName(request::RouterEngineType engine) {
+    switch (engine) {
+        case request::RouterEngineType::ALL_PAIRS:
+            return "all_pairs";
+        case request::RouterEngineType::DIJKSTRA:
+            return "dijkstra";
+        case request::RouterEngineType::CONTRACTION_HIERARCHIES:
+            return "contraction_hierarchies";
+        case request::RouterEngineType::A_STAR:
+            return "a_star";
+        case request::RouterEngineType::ALT:
+            return "alt";
+        case request::RouterEngineType::RAPTOR:
+            return "raptor";
+        case request::RouterEngineType::HUB_LABELS:
+            return "hub_labels";
+        case request::RouterEngineType::CUSTOMIZABLE_ROUTE_PLANNING:
+            return "customizable_route_planning";
+    }
+    return "";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    bench::NetworkParams params;
+    params.stop_count = argc > 1 ? stoul(argv[1]) : 600;
+    params.bus_count = argc > 2 ? stoul(argv[2]) : 60;
+    const size_t query_count = argc > 3 ? stoul(argv[3]) : 600;
+    const data::TransportCatalogue catalogue = bench::MakeSyntheticNetwork(params);
+    const auto queries = bench::MakeRandomQueries(bench::GetServedStops(catalogue), query_count);
+
+    size_t total_mismatch_count = 0;
+    cout << fixed << setprecision(0);
+    for (const auto engine : {request::RouterEngineType::ALL_PAIRS, request::RouterEngineType::DIJKSTRA,
+                              request::RouterEngineType::CONTRACTION_HIERARCHIES, request::RouterEngineType::A_STAR,
+                              request::RouterEngineType::ALT, request::RouterEngineType::RAPTOR,
+                              request::RouterEngineType::HUB_LABELS,
+                              request::RouterEngineType::CUSTOMIZABLE_ROUTE_PLANNING}) {
+        for (const size_t route_cache_size : {0, 64}) {
+            for (const size_t weight_units_per_minute : {0, 600}) {
+                request::RoutingSettings settings;
+                settings.bus_wait_time = 6;
+                settings.bus_velocity = 40;
+                settings.router_engine = engine;
+                settings.weight_units_per_minute = weight_units_per_minute;
+                const ReferenceAnswers reference = MakeReferenceAnswers(
+                    router::TransportCatalogueRouter(catalogue, settings), queries);
+                settings.route_cache_size = route_cache_size;
+                const router::TransportCatalogueRouter router(catalogue, settings);
+
+                cout << GetEngineName(engine) << ", cache " << route_cache_size << ", units "
+                     << weight_units_per_minute << ":";
+                double single_thread_ms = 0;
+                for (const size_t thread_count : {1, 2, 4, 8}) {
+                    const auto [elapsed_ms, mismatch_count] = RunQueries(router, queries, reference, thread_count);
+                    if (thread_count == 1) {
+                        single_thread_ms = elapsed_ms;
+                    }
+                    total_mismatch_count += mismatch_count;
+                    cout << " " << thread_count << "t " << queries.size() * 1000 / elapsed_ms << " q/s (x"
+                         << setprecision(2) << single_thread_ms / elapsed_ms << setprecision(0) << ")";
+                    if (mismatch_count > 0) {
+                        cout << " MISMATCHES " << mismatch_count;
+                    }
+                }
+                cout << endl;
+            }
+        }
+    }
+    cout << (total_mismatch_count == 0 ? "All answers match the single-threaded ones" : "Answers differ") << endl;
+    return total_mismatch_count == 0 ? 0 : 1;
+}
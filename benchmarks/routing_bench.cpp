@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "json_reader.h"
+#include "router.h"
+#include "synthetic_network.h"
+#include "transport_router.h"
+
+using namespace std;
+
+// Бенчмарки маршрутизатора на синтетической сети. Режимы:
+//   threads [stop_count bus_count] - предрасчёт таблицы all_pairs на 1/2/4/8 потоках и сверка с однопоточной
+//   models [stop_count bus_count] - модели графа stop_pairs и bus_lines: рёбра, построение, запросы, сверка ответов
+//   compare <input.json> - ответы на запросы Route из файла в обеих моделях графа
+//   layout [stop_count bus_count] - время построения и память маршрутизатора, плотные массивы против хеш-таблиц
+//   order [stop_count bus_count] - время запросов с перенумерацией вершин вдоль кривой Гильберта и без неё
+
+// Учёт занятой динамической памяти: перед каждым блоком хранится его размер.
+// Замены new и delete не встраиваются, иначе компилятор сопоставляет malloc и free со сдвинутым указателем
+namespace {
+
+constexpr size_t ALLOCATION_HEADER_SIZE = alignof(max_align_t);
+atomic<size_t> allocated_bytes = 0;
+
+}  // namespace
+
+[[gnu::noinline]] void *operator new(size_t size) {
+    void *block = malloc(size + ALLOCATION_HEADER_SIZE);
+    if (block == nullptr) {
+        throw bad_alloc();
+    }
+    *static_cast<size_t *>(block) = size;
+    allocated_bytes += size;
+    return static_cast<char *>(block) + ALLOCATION_HEADER_SIZE;
+}
+
+[[gnu::noinline]] void operator delete(void *pointer) noexcept {
+    if (pointer == nullptr) {
+        return;
+    }
+    void *block = static_cast<char *>(pointer) - ALLOCATION_HEADER_SIZE;
+    allocated_bytes -= *static_cast<size_t *>(block);
+    free(block);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+namespace {
+
+double ToMegabytes(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+template <typename Function>
+double MeasureMilliseconds(Function function) {
+    const auto start = chrono::steady_clock::now();
+    function();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+bench::NetworkParams ReadNetworkParams(int argc, char **argv, size_t stop_count, size_t bus_count) {
+    bench::NetworkParams params;
+    params.stop_count = argc > 2 ? stoul(argv[2]) : stop_count;
+    params.bus_count = argc > 3 ? stoul(argv[3]) : bus_count;
+    return params;
+}
+
+request::RoutingSettings MakeRoutingSettings(request::RouterEngineType engine, request::RouterGraphModel model) {
+    request::RoutingSettings settings;
+    settings.bus_wait_time = 6;
+    settings.bus_velocity = 40;
+    settings.router_engine = engine;
+    settings.graph_model = model;
+    return settings;
+}
+
+// Одинаковы ли таблицы двух движков all_pairs до последнего бита: веса и рёбра всех маршрутов
+bool AreRouteTablesIdentical(const graph::Router<double> &lhs, const graph::Router<double> &rhs,
+                             size_t vertex_count) {
+    vector<graph::VertexId> vertexes(vertex_count);
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        vertexes[vertex] = vertex;
+    }
+    const auto lhs_weights = lhs.BuildWeightsMatrix(vertexes, vertexes);
+    const auto rhs_weights = rhs.BuildWeightsMatrix(vertexes, vertexes);
+    for (size_t index = 0; index < lhs_weights.size(); ++index) {
+        if (lhs_weights[index].has_value() != rhs_weights[index].has_value()
+            || (lhs_weights[index] && memcmp(&*lhs_weights[index], &*rhs_weights[index], sizeof(double)) != 0)) {
+            return false;
+        }
+    }
+    for (const graph::VertexId from : vertexes) {
+        for (const graph::VertexId to : vertexes) {
+            const auto lhs_route = lhs.BuildRoute(from, to);
+            const auto rhs_route = rhs.BuildRoute(from, to);
+            if (lhs_route.has_value() != rhs_route.has_value() || (lhs_route && lhs_route->edges != rhs_route->edges)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+const char *GetModelName(request::RouterGraphModel model) {
+    return model == request::RouterGraphModel::STOP_PAIRS ? "stop_pairs" : "bus_lines";
+}
+
+// Одинаковы ли ответы: время в пути и все элементы маршрута, включая span_count
+bool AreRoutesIdentical(const optional<request::StatRouteInfo> &lhs, const optional<request::StatRouteInfo> &rhs) {
+    static constexpr double EPSILON = 1e-9;
+    if (lhs.has_value() != rhs.has_value()) {
+        return false;
+    }
+    if (!lhs) {
+        return true;
+    }
+    if (abs(lhs->weight - rhs->weight) > EPSILON || lhs->route.size() != rhs->route.size()) {
+        return false;
+    }
+    for (size_t index = 0; index < lhs->route.size(); ++index) {
+        const request::Route &lhs_item = lhs->route[index];
+        const request::Route &rhs_item = rhs->route[index];
+        if (lhs_item.is_wait != rhs_item.is_wait || lhs_item.stop != rhs_item.stop
+            || (!lhs_item.is_wait && lhs_item.bus != rhs_item.bus) || lhs_item.span_count != rhs_item.span_count
+            || abs(lhs_item.weight - rhs_item.weight) > EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Сравнивает ответы обеих моделей графа на запросы queries и печатает число расхождений
+void CompareGraphModels(const data::TransportCatalogue &catalogue, request::RoutingSettings settings,
+                        const vector<pair<string_view, string_view>> &queries) {
+    settings.graph_model = request::RouterGraphModel::STOP_PAIRS;
+    const router::TransportCatalogueRouter stop_pairs_router(catalogue, settings);
+    settings.graph_model = request::RouterGraphModel::BUS_LINES;
+    const router::TransportCatalogueRouter bus_lines_router(catalogue, settings);
+    size_t weight_mismatch_count = 0;
+    size_t route_mismatch_count = 0;
+    for (const auto &[from, to] : queries) {
+        const auto stop_pairs_route = stop_pairs_router.BuildRoute(from, to);
+        const auto bus_lines_route = bus_lines_router.BuildRoute(from, to);
+        if (stop_pairs_route.has_value() != bus_lines_route.has_value()
+            || (stop_pairs_route && abs(stop_pairs_route->weight - bus_lines_route->weight) > 1e-9)) {
+            ++weight_mismatch_count;
+        }
+        if (!AreRoutesIdentical(stop_pairs_route, bus_lines_route)) {
+            ++route_mismatch_count;
+        }
+    }
+    // При одинаковом времени в пути модели могут выбрать разные, но равные по времени пересадки
+    cout << queries.size() << " Route queries: " << weight_mismatch_count << " differ in total time, "
+         << route_mismatch_count - weight_mismatch_count << " differ only in Wait/Bus items of an equally fast route"
+         << endl;
+}
+
+void RunModelsBenchmark(const bench::NetworkParams &params) {
+    static constexpr size_t QUERY_COUNT = 200;
+    const data::TransportCatalogue catalogue = bench::MakeSyntheticNetwork(params);
+    const auto queries = bench::MakeRandomQueries(bench::GetServedStops(catalogue), QUERY_COUNT);
+    cout << fixed << setprecision(1);
+    for (const auto model : {request::RouterGraphModel::STOP_PAIRS, request::RouterGraphModel::BUS_LINES}) {
+        unique_ptr<router::TransportCatalogueRouter> router;
+        const double build_ms = MeasureMilliseconds([&] {
+            router = make_unique<router::TransportCatalogueRouter>(
+                catalogue, MakeRoutingSettings(request::RouterEngineType::DIJKSTRA, model));
+        });
+        const double query_ms = MeasureMilliseconds([&] {
+            for (const auto &[from, to] : queries) {
+                router->BuildRoute(from, to);
+            }
+        });
+        cout << GetModelName(model) << ": " << router->GetGraph().GetVertexCount() << " vertexes, "
+             << router->GetGraph().GetEdgeCount() << " edges, build " << build_ms << " ms, dijkstra query "
+             << query_ms * 1000 / queries.size() << " us" << endl;
+    }
+    CompareGraphModels(catalogue, MakeRoutingSettings(request::RouterEngineType::DIJKSTRA,
+                                                      request::RouterGraphModel::STOP_PAIRS), queries);
+}
+
+void RunCompareModels(const string &path) {
+    ifstream input(path);
+    if (!input) {
+        cerr << "Cannot open " << path << endl;
+        return;
+    }
+    const json::Document doc = json::Load(input);
+    const data::TransportCatalogue catalogue = request::MakeCatalogueFromJSON(doc);
+    vector<pair<string_view, string_view>> queries;
+    for (const auto &node : doc.GetRoot().AsDict().at("stat_requests"s).AsArray()) {
+        const auto &stat_request = node.AsDict();
+        if (stat_request.at("type"s).AsString() == "Route"s) {
+            queries.emplace_back(stat_request.at("from"s).AsString(), stat_request.at("to"s).AsString());
+        }
+    }
+    request::RoutingSettings settings = request::LoadRoutingSettings(doc);
+    settings.route_cache_size = 0;
+    CompareGraphModels(catalogue, settings, queries);
+}
+
+// Описание ребра того же размера, что и у TransportCatalogueRouter
+struct EdgeInfo {
+    int type;
+    const data::Bus *bus_ptr;
+    const data::Stop *stop_from_ptr;
+    const data::Stop *stop_to_ptr;
+    int span_count;
+};
+
+struct StopVertexes {
+    size_t portal;
+    size_t hub;
+};
+
+// Заполняет описания рёбер и вершины остановок в контейнерах Edges и Stops и читает каждое описание
+// столько раз, сколько его читает построение ответа на запрос. Печатает время и занятую память
+template <typename EdgesContainer, typename StopsContainer, typename StopKey>
+void MeasureMetadataLayout(const char *name, size_t edge_count, const vector<StopKey> &stop_keys) {
+    static constexpr size_t LOOKUPS_PER_EDGE = 3;
+    const size_t bytes_before = allocated_bytes;
+    EdgesContainer edges;
+    StopsContainer stops_vertexes;
+    const double build_ms = MeasureMilliseconds([&] {
+        if constexpr (is_same_v<EdgesContainer, vector<EdgeInfo>>) {
+            edges.resize(edge_count);
+            stops_vertexes.resize(*max_element(stop_keys.begin(), stop_keys.end()) + 1);
+        }
+        for (size_t edge_id = 0; edge_id < edge_count; ++edge_id) {
+            edges[edge_id] = EdgeInfo{0, nullptr, nullptr, nullptr, static_cast<int>(edge_id % 7)};
+        }
+        for (size_t stop_index = 0; stop_index < stop_keys.size(); ++stop_index) {
+            stops_vertexes[stop_keys[stop_index]] = StopVertexes{2 * stop_index, 2 * stop_index + 1};
+        }
+    });
+    const size_t bytes = allocated_bytes - bytes_before;
+    long long checksum = 0;
+    const double lookup_ms = MeasureMilliseconds([&] {
+        for (size_t round = 0; round < LOOKUPS_PER_EDGE; ++round) {
+            for (size_t edge_id = 0; edge_id < edge_count; edge_id += 1 + round) {
+                checksum += edges[edge_id].span_count;
+            }
+            for (const auto &key : stop_keys) {
+                checksum += static_cast<long long>(stops_vertexes[key].hub);
+            }
+        }
+    });
+    cout << name << ": fill " << build_ms << " ms, " << ToMegabytes(bytes) << " MiB, lookups " << lookup_ms
+         << " ms (checksum " << checksum << ")" << endl;
+}
+
+void RunLayoutBenchmark(const bench::NetworkParams &params) {
+    const data::TransportCatalogue catalogue = bench::MakeSyntheticNetwork(params);
+    cout << fixed << setprecision(1);
+    size_t edge_count = 0;
+    for (const auto model : {request::RouterGraphModel::STOP_PAIRS, request::RouterGraphModel::BUS_LINES}) {
+        const size_t bytes_before = allocated_bytes;
+        unique_ptr<router::TransportCatalogueRouter> router;
+        const double build_ms = MeasureMilliseconds([&] {
+            router = make_unique<router::TransportCatalogueRouter>(
+                catalogue, MakeRoutingSettings(request::RouterEngineType::DIJKSTRA, model));
+        });
+        cout << GetModelName(model) << " router: " << router->GetGraph().GetEdgeCount() << " edges, build "
+             << build_ms << " ms, " << ToMegabytes(allocated_bytes - bytes_before) << " MiB" << endl;
+        if (model == request::RouterGraphModel::STOP_PAIRS) {
+            edge_count = router->GetGraph().GetEdgeCount();
+        }
+    }
+
+    // Метаданные stop_pairs в нынешнем виде (массивы по EdgeId и Stop::index)
+    // и в прежнем (хеш-таблицы по EdgeId и по указателю на остановку)
+    vector<size_t> stop_indexes;
+    vector<const data::Stop *> stop_pointers;
+    for (const auto &[name, stop_ptr] : catalogue.GetSortedStops()) {
+        stop_indexes.push_back(stop_ptr->index);
+        stop_pointers.push_back(stop_ptr);
+    }
+    MeasureMetadataLayout<vector<EdgeInfo>, vector<StopVertexes>>("dense vectors", edge_count, stop_indexes);
+    MeasureMetadataLayout<unordered_map<size_t, EdgeInfo>, unordered_map<const data::Stop *, StopVertexes>>(
+        "hash maps", edge_count, stop_pointers);
+}
+
+void RunThreadsBenchmark(const bench::NetworkParams &params) {
+    const data::TransportCatalogue catalogue = bench::MakeSyntheticNetwork(params);
+    const router::TransportCatalogueRouter router(
+        catalogue, MakeRoutingSettings(request::RouterEngineType::DIJKSTRA, request::RouterGraphModel::STOP_PAIRS));
+    const auto &graph = router.GetGraph();
+    cout << "all_pairs precompute: " << graph.GetVertexCount() << " vertexes, " << graph.GetEdgeCount()
+         << " edges" << endl;
+
+    unique_ptr<graph::Router<double>> serial;
+    const double serial_ms = MeasureMilliseconds([&] {
+        serial = make_unique<graph::Router<double>>(graph, 1);
+    });
+    cout << fixed << setprecision(1);
+    for (const size_t thread_count : {1, 2, 4, 8}) {
+        unique_ptr<graph::Router<double>> parallel;
+        const double parallel_ms = MeasureMilliseconds([&] {
+            parallel = make_unique<graph::Router<double>>(graph, thread_count);
+        });
+        cout << "threads " << thread_count << ": " << parallel_ms << " ms, speedup "
+             << setprecision(2) << serial_ms / parallel_ms << setprecision(1) << ", identical to serial: "
+             << (AreRouteTablesIdentical(*serial, *parallel, graph.GetVertexCount()) ? "yes" : "NO") << endl;
+    }
+}
+
+void RunOrderBenchmark(const bench::NetworkParams &params) {
+    static constexpr size_t QUERY_COUNT = 200;
+    static constexpr size_t ROUND_COUNT = 3;
+    const data::TransportCatalogue catalogue = bench::MakeSyntheticNetwork(params);
+    const auto queries = bench::MakeRandomQueries(bench::GetServedStops(catalogue), QUERY_COUNT);
+    cout << fixed << setprecision(1);
+    for (const auto model : {request::RouterGraphModel::STOP_PAIRS, request::RouterGraphModel::BUS_LINES}) {
+        vector<optional<request::StatRouteInfo>> initial_answers;
+        for (const bool reorder_vertexes : {false, true}) {
+            request::RoutingSettings settings = MakeRoutingSettings(request::RouterEngineType::DIJKSTRA, model);
+            settings.reorder_vertexes = reorder_vertexes;
+            const router::TransportCatalogueRouter router(catalogue, settings);
+            vector<optional<request::StatRouteInfo>> answers(queries.size());
+            // Лучший из нескольких прогонов, чтобы меньше зависеть от фоновой нагрузки
+            double query_ms = numeric_limits<double>::infinity();
+            for (size_t round = 0; round < ROUND_COUNT; ++round) {
+                query_ms = min(query_ms, MeasureMilliseconds([&] {
+                    for (size_t index = 0; index < queries.size(); ++index) {
+                        answers[index] = router.BuildRoute(queries[index].first, queries[index].second);
+                    }
+                }));
+            }
+            cout << GetModelName(model) << (reorder_vertexes ? ", hilbert order" : ", creation order")
+                 << ": dijkstra query " << query_ms * 1000 / queries.size() << " us";
+            if (reorder_vertexes) {
+                // Номера вершин влияют только на выбор среди одинаково быстрых маршрутов
+                size_t differ_count = 0;
+                for (size_t index = 0; index < queries.size(); ++index) {
+                    if (answers[index].has_value() != initial_answers[index].has_value()
+                        || (answers[index] && abs(answers[index]->weight - initial_answers[index]->weight) > 1e-9)) {
+                        ++differ_count;
+                    }
+                }
+                cout << ", " << differ_count << " answers differ in total time";
+            }
+            cout << endl;
+            initial_answers = move(answers);
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const string_view mode = argc > 1 ? argv[1] : "";
+    if (mode == "threads") {
+        RunThreadsBenchmark(ReadNetworkParams(argc, argv, 1000, 100));
+    } else if (mode == "models") {
+        RunModelsBenchmark(ReadNetworkParams(argc, argv, 10000, 1000));
+    } else if (mode == "layout") {
+        RunLayoutBenchmark(ReadNetworkParams(argc, argv, 60000, 7000));
+    } else if (mode == "order") {
+        RunOrderBenchmark(ReadNetworkParams(argc, argv, 60000, 7000));
+    } else if (mode == "compare" && argc > 2) {
+        RunCompareModels(argv[2]);
+    } else {
+        cerr << "Usage: routing_bench threads|models|layout|order [stop_count bus_count]" << endl
+             << "       routing_bench compare <input.json>" << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "geo.h"
+#include "transport_catalogue.h"
+
+namespace bench {
+
+// Синтетическая городская сеть: остановки стоят в узлах квадратной решётки с шагом около 500 м
+// со случайным сдвигом, автобус идёт от случайной остановки по соседним узлам, в основном
+// в одном направлении. Одинаковые параметры дают одну и ту же сеть
+struct NetworkParams {
+    size_t stop_count = 1000;
+    size_t bus_count = 100;
+    // Наибольшее число остановок маршрута в одну сторону
+    size_t max_route_length = 30;
+    // Доля кольцевых маршрутов
+    double roundtrip_share = 0.3;
+    unsigned seed = 1;
+};
+
+inline data::TransportCatalogue MakeSyntheticNetwork(const NetworkParams &params) {
+    static constexpr double LAT_STEP = 0.0045;
+    static constexpr double LNG_STEP = 0.008;
+    static constexpr int DIRECTIONS[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+
+    data::TransportCatalogue catalogue;
+    std::mt19937 generator(params.seed);
+    std::uniform_real_distribution<double> jitter(-0.3, 0.3);
+    std::uniform_real_distribution<double> detour(1.1, 1.5);
+    std::uniform_real_distribution<double> chance(0, 1);
+
+    const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(params.stop_count))));
+    std::vector<std::string> stop_names;
+    stop_names.reserve(params.stop_count);
+    for (size_t stop_index = 0; stop_index < params.stop_count; ++stop_index) {
+        stop_names.push_back("Stop " + std::to_string(stop_index));
+        const int row = static_cast<int>(stop_index) / side;
+        const int column = static_cast<int>(stop_index) % side;
+        catalogue.AddStop(stop_names.back(), {55.6 + (row + jitter(generator)) * LAT_STEP,
+                                              37.4 + (column + jitter(generator)) * LNG_STEP});
+    }
+
+    const auto get_stop_index = [&params, side](int row, int column) -> std::optional<size_t> {
+        if (row < 0 || column < 0 || column >= side) {
+            return std::nullopt;
+        }
+        const size_t stop_index = static_cast<size_t>(row) * side + column;
+        return stop_index < params.stop_count ? std::optional(stop_index) : std::nullopt;
+    };
+
+    std::set<std::pair<size_t, size_t>> known_distances;
+    const auto set_distance = [&](size_t from, size_t to) {
+        if (from == to || known_distances.count({from, to}) > 0 || known_distances.count({to, from}) > 0) {
+            return;
+        }
+        known_distances.insert({from, to});
+        const double distance = geo::ComputeDistance(catalogue.GetStop(stop_names[from])->coordinates,
+                                                     catalogue.GetStop(stop_names[to])->coordinates);
+        catalogue.SetStopsDistance(stop_names[from], stop_names[to],
+                                   static_cast<int>(distance * detour(generator)) + 10);
+    };
+
+    std::uniform_int_distribution<size_t> random_stop(0, params.stop_count - 1);
+    std::uniform_int_distribution<size_t> random_length(2, std::max<size_t>(params.max_route_length, 2));
+    std::uniform_int_distribution<int> random_direction(0, 7);
+    for (size_t bus_index = 0; bus_index < params.bus_count; ++bus_index) {
+        std::vector<size_t> route{random_stop(generator)};
+        const size_t length = random_length(generator);
+        int direction = random_direction(generator);
+        while (route.size() < length) {
+            // Чаще всего автобус едет прямо, иногда поворачивает на 45 градусов
+            if (chance(generator) > 0.7) {
+                direction = (direction + (chance(generator) < 0.5 ? 1 : 7)) % 8;
+            }
+            const int row = static_cast<int>(route.back()) / side;
+            const int column = static_cast<int>(route.back()) % side;
+            std::optional<size_t> next;
+            for (int turn = 0; turn < 8 && !next; ++turn) {
+                const int candidate_direction = (direction + (turn % 2 == 0 ? turn / 2 : 8 - (turn + 1) / 2)) % 8;
+                const auto candidate = get_stop_index(row + DIRECTIONS[candidate_direction][0],
+                                                      column + DIRECTIONS[candidate_direction][1]);
+                if (candidate && std::find(route.begin(), route.end(), *candidate) == route.end()) {
+                    next = candidate;
+                    direction = candidate_direction;
+                }
+            }
+            if (!next) {
+                break;
+            }
+            route.push_back(*next);
+        }
+        if (route.size() < 2) {
+            continue;
+        }
+
+        const bool is_roundtrip = chance(generator) < params.roundtrip_share;
+        std::vector<std::string_view> stops;
+        for (const size_t stop_index : route) {
+            stops.push_back(stop_names[stop_index]);
+        }
+        if (is_roundtrip) {
+            stops.push_back(stop_names[route.front()]);
+            set_distance(route.back(), route.front());
+        } else {
+            stops.insert(stops.end(), std::next(stops.rbegin()), stops.rend());
+        }
+        for (size_t position = 0; position + 1 < route.size(); ++position) {
+            set_distance(route[position], route[position + 1]);
+        }
+        catalogue.AddBusRoute("Bus " + std::to_string(bus_index), stops, is_roundtrip);
+    }
+    catalogue.ComputeBusesStats();
+    return catalogue;
+}
+
+// Названия остановок, через которые проходит хотя бы один автобус, по возрастанию
+inline std::vector<std::string_view> GetServedStops(const data::TransportCatalogue &catalogue) {
+    std::vector<std::string_view> result;
+    for (const auto &[name, _] : catalogue.GetSortedStops()) {
+        result.push_back(name);
+    }
+    return result;
+}
+
+// Случайные пары остановок для запросов Route
+inline std::vector<std::pair<std::string_view, std::string_view>> MakeRandomQueries(
+    const std::vector<std::string_view> &stops, size_t query_count, unsigned seed = 7) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<size_t> random_stop(0, stops.size() - 1);
+    std::vector<std::pair<std::string_view, std::string_view>> result;
+    result.reserve(query_count);
+    for (size_t query_index = 0; query_index < query_count; ++query_index) {
+        const size_t from = random_stop(generator);
+        result.emplace_back(stops[from], stops[random_stop(generator)]);
+    }
+    return result;
+}
+
+}  // namespace bench
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "router.h"
+#include "scratch_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Целенаправленный поиск A*: вершины извлекаются из очереди по сумме пройденного веса
+// и нижней оценки остатка пути до цели. Оценка должна быть допустимой (не больше
+// настоящего веса пути), иначе найденный маршрут может оказаться не кратчайшим.
+// Граф должен быть заморожен: рёбра перебираются по его CSR-представлению.
+// Запросы можно выполнять из нескольких потоков одновременно, если эвристика это допускает.
+template <typename Weight>
+class AStarRouter final : public RouterEngine<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+    using Heuristic = std::function<Weight(VertexId vertex, VertexId target)>;
+
+    AStarRouter(const Graph& graph, Heuristic heuristic);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Число вершин, извлечённых из очереди последним завершённым запросом
+    size_t GetLastSettledCount() const {
+        return last_settled_count_;
+    }
+
+private:
+    // Приоритет в очереди, пройденный вес и вершина
+    using QueueItem = std::tuple<Weight, Weight, VertexId>;
+
+    // Буферы поиска. Вершина считается посещённой в текущем поиске, если её метка равна current_stamp
+    struct SearchSpace {
+        std::uint32_t current_stamp = 0;
+        std::vector<std::uint32_t> stamps;
+        std::vector<Weight> weights;
+        std::vector<std::optional<EdgeId>> prev_edges;
+        std::vector<QueueItem> queue;
+
+        explicit SearchSpace(size_t vertex_count)
+            : stamps(vertex_count, 0)
+            , weights(vertex_count)
+            , prev_edges(vertex_count) {
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return stamps[vertex] == current_stamp;
+        }
+
+        void Start() {
+            if (++current_stamp == 0) {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                current_stamp = 1;
+            }
+            queue.clear();
+        }
+    };
+
+    void Reach(SearchSpace& search, VertexId vertex, VertexId target, Weight weight,
+               std::optional<EdgeId> prev_edge) const {
+        search.stamps[vertex] = search.current_stamp;
+        search.weights[vertex] = weight;
+        search.prev_edges[vertex] = prev_edge;
+        search.queue.emplace_back(weight + heuristic_(vertex, target), weight, vertex);
+        std::push_heap(search.queue.begin(), search.queue.end(), std::greater<QueueItem>{});
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    Heuristic heuristic_;
+
+    concurrency::ScratchPool<SearchSpace> search_spaces_;
+    mutable std::atomic<size_t> last_settled_count_{0};
+};
+
+// Ориентиры для эвристики ALT (A*, Landmarks, Triangle inequality).
+// Для каждого ориентира L заранее считаются веса путей L -> v и v -> L, после чего
+// по неравенству треугольника нижняя оценка пути v -> t равна максимуму из
+// d(L, t) - d(L, v) и d(v, L) - d(t, L) по всем ориентирам.
+template <typename Weight>
+class Landmarks {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    Landmarks(const Graph& graph, size_t landmark_count);
+
+    Weight GetLowerBound(VertexId vertex, VertexId target) const;
+
+    const std::vector<VertexId>& GetLandmarks() const {
+        return landmarks_;
+    }
+
+private:
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+                                              ? std::numeric_limits<Weight>::infinity()
+                                              : std::numeric_limits<Weight>::max();
+
+    // Веса путей от ориентира до всех вершин (или от всех вершин до ориентира при is_backward)
+    std::vector<Weight> ComputeWeights(VertexId landmark, bool is_backward) const;
+
+    static bool IsFinite(Weight weight) {
+        return weight < INFINITE_WEIGHT;
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    std::vector<std::vector<EdgeId>> incoming_edges_;
+    std::vector<VertexId> landmarks_;
+    // Веса хранятся по вершинам: [vertex * landmarks_.size() + landmark_index]
+    std::vector<Weight> weights_from_landmarks_;
+    std::vector<Weight> weights_to_landmarks_;
+};
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, Heuristic heuristic)
+    : graph_(graph)
+    , heuristic_(std::move(heuristic))
+    , search_spaces_([vertex_count = graph.GetVertexCount()] {
+        return std::make_unique<SearchSpace>(vertex_count);
+    })
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+    const auto search = search_spaces_.Acquire();
+    search->Start();
+    Reach(*search, from, to, ZERO_WEIGHT, std::nullopt);
+
+    bool is_found = false;
+    size_t settled_count = 0;
+    while (!search->queue.empty()) {
+        std::pop_heap(search->queue.begin(), search->queue.end(), std::greater<QueueItem>{});
+        const auto [_, weight, vertex] = search->queue.back();
+        search->queue.pop_back();
+        if (search->weights[vertex] < weight) {
+            continue;
+        }
+        ++settled_count;
+        if (vertex == to) {
+            is_found = true;
+            break;
+        }
+        for (const auto& edge : graph_.GetOutgoingEdges(vertex)) {
+            const Weight candidate_weight = weight + edge.weight;
+            if (!search->IsReached(edge.to) || candidate_weight < search->weights[edge.to]) {
+                Reach(*search, edge.to, to, candidate_weight, edge.id);
+            }
+        }
+    }
+    last_settled_count_ = settled_count;
+    if (!is_found) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = search->prev_edges[to];
+         edge_id;
+         edge_id = search->prev_edges[graph_.GetEdge(*edge_id).from])
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{search->weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+Landmarks<Weight>::Landmarks(const Graph& graph, size_t landmark_count)
+    : graph_(graph)
+    , incoming_edges_(graph.GetVertexCount())
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    const size_t vertex_count = graph.GetVertexCount();
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        incoming_edges_[edge.to].push_back(edge_id);
+    }
+    landmark_count = std::min(landmark_count, vertex_count);
+
+    // Ориентиры выбираются жадно: каждый следующий - самая удалённая от уже выбранных вершина.
+    // Первым берётся самая удалённая от вершины 0
+    std::vector<std::vector<Weight>> weights_from;
+    std::vector<std::vector<Weight>> weights_to;
+    std::vector<Weight> min_weights;
+    if (landmark_count > 0) {
+        min_weights = ComputeWeights(0, false);
+    }
+    while (landmarks_.size() < landmark_count) {
+        VertexId landmark = 0;
+        for (VertexId vertex = 1; vertex < vertex_count; ++vertex) {
+            if (min_weights[landmark] < min_weights[vertex]) {
+                landmark = vertex;
+            }
+        }
+        // Все вершины совпадают с уже выбранными ориентирами или достижимы из них бесплатно
+        if (!landmarks_.empty() && !(ZERO_WEIGHT < min_weights[landmark])) {
+            break;
+        }
+        if (landmarks_.empty()) {
+            min_weights.assign(vertex_count, INFINITE_WEIGHT);
+        }
+        landmarks_.push_back(landmark);
+        weights_from.push_back(ComputeWeights(landmark, false));
+        weights_to.push_back(ComputeWeights(landmark, true));
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            min_weights[vertex] = std::min(min_weights[vertex], weights_from.back()[vertex]);
+        }
+    }
+
+    weights_from_landmarks_.resize(vertex_count * landmarks_.size());
+    weights_to_landmarks_.resize(vertex_count * landmarks_.size());
+    for (size_t index = 0; index < landmarks_.size(); ++index) {
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            weights_from_landmarks_[vertex * landmarks_.size() + index] = weights_from[index][vertex];
+            weights_to_landmarks_[vertex * landmarks_.size() + index] = weights_to[index][vertex];
+        }
+    }
+    incoming_edges_.clear();
+    incoming_edges_.shrink_to_fit();
+}
+
+template <typename Weight>
+std::vector<Weight> Landmarks<Weight>::ComputeWeights(VertexId landmark, bool is_backward) const {
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::vector<Weight> weights(graph_.GetVertexCount(), INFINITE_WEIGHT);
+    std::vector<QueueItem> queue;
+    weights[landmark] = ZERO_WEIGHT;
+    queue.emplace_back(ZERO_WEIGHT, landmark);
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        const auto [weight, vertex] = queue.back();
+        queue.pop_back();
+        if (weights[vertex] < weight) {
+            continue;
+        }
+        const auto relax = [&](VertexId next_vertex, Weight edge_weight) {
+            const Weight candidate_weight = weight + edge_weight;
+            if (candidate_weight < weights[next_vertex]) {
+                weights[next_vertex] = candidate_weight;
+                queue.emplace_back(candidate_weight, next_vertex);
+                std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+            }
+        };
+        if (is_backward) {
+            for (const EdgeId edge_id : incoming_edges_[vertex]) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                relax(edge.from, edge.weight);
+            }
+        } else {
+            for (const auto& edge : graph_.GetOutgoingEdges(vertex)) {
+                relax(edge.to, edge.weight);
+            }
+        }
+    }
+    return weights;
+}
+
+template <typename Weight>
+Weight Landmarks<Weight>::GetLowerBound(VertexId vertex, VertexId target) const {
+    const size_t landmark_count = landmarks_.size();
+    const Weight* from_vertex = weights_from_landmarks_.data() + vertex * landmark_count;
+    const Weight* from_target = weights_from_landmarks_.data() + target * landmark_count;
+    const Weight* to_vertex = weights_to_landmarks_.data() + vertex * landmark_count;
+    const Weight* to_target = weights_to_landmarks_.data() + target * landmark_count;
+
+    Weight result = ZERO_WEIGHT;
+    for (size_t index = 0; index < landmark_count; ++index) {
+        // Слагаемые с недостижимыми вершинами ничего не говорят о пути и пропускаются
+        if (IsFinite(from_vertex[index]) && IsFinite(from_target[index]) && from_vertex[index] < from_target[index]) {
+            result = std::max(result, from_target[index] - from_vertex[index]);
+        }
+        if (IsFinite(to_vertex[index]) && IsFinite(to_target[index]) && to_target[index] < to_vertex[index]) {
+            result = std::max(result, to_vertex[index] - to_target[index]);
+        }
+    }
+    return result;
+}
+
+}  // namespace graph
@@ -0,0 +1,541 @@
+#pragma once
+
+#include "router.h"
+#include "scratch_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Маршрутизация по иерархиям сжатия (Contraction Hierarchies).
+// При построении вершины упорядочиваются по важности и поочерёдно стягиваются, а для
+// сохранения кратчайших расстояний в граф добавляются рёбра-сокращения (shortcuts).
+// Запрос - двунаправленный поиск только "вверх" по иерархии, найденные сокращения
+// раскрываются обратно в рёбра исходного графа.
+// Запросы можно выполнять из нескольких потоков одновременно.
+template <typename Weight>
+class ContractionHierarchiesRouter final : public RouterEngine<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+
+    // Сколько вершин может просмотреть поиск свидетеля, прежде чем сдаться и добавить сокращение
+    static constexpr size_t WITNESS_SEARCH_SETTLED_LIMIT = 256;
+
+    explicit ContractionHierarchiesRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Матрица весов корзинным алгоритмом (bucket-based many-to-many): полный обратный поиск
+    // вверх из каждой цели раскладывает веса по корзинам вершин, после чего полный прямой поиск
+    // вверх из каждого источника собирает их. Стоимость - |sources| + |targets| поисков вместо их произведения
+    std::vector<std::optional<Weight>> BuildWeightsMatrix(const std::vector<VertexId>& sources,
+                                                          const std::vector<VertexId>& targets) const override;
+
+    size_t GetShortcutCount() const {
+        return shortcuts_.size();
+    }
+
+private:
+    using QueueItem = std::pair<Weight, VertexId>;
+
+    // Буферы поиска Дейкстры, которые не нужно очищать между запусками
+    struct SearchSpace {
+        std::uint32_t current_stamp = 0;
+        std::vector<std::uint32_t> stamps;
+        std::vector<Weight> weights;
+        std::vector<std::optional<EdgeId>> prev_edges;
+        std::vector<QueueItem> queue;
+
+        explicit SearchSpace(size_t vertex_count)
+            : stamps(vertex_count, 0)
+            , weights(vertex_count)
+            , prev_edges(vertex_count) {
+        }
+
+        void Start() {
+            if (++current_stamp == 0) {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                current_stamp = 1;
+            }
+            queue.clear();
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return stamps[vertex] == current_stamp;
+        }
+
+        void Reach(VertexId vertex, Weight weight, std::optional<EdgeId> prev_edge) {
+            stamps[vertex] = current_stamp;
+            weights[vertex] = weight;
+            prev_edges[vertex] = prev_edge;
+            queue.emplace_back(weight, vertex);
+            std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        }
+
+        // Извлекает из очереди ближайшую вершину, пропуская устаревшие записи
+        std::optional<QueueItem> PopNearest() {
+            while (!queue.empty()) {
+                std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+                const QueueItem item = queue.back();
+                queue.pop_back();
+                if (!(weights[item.second] < item.first)) {
+                    return item;
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::optional<Weight> MinQueuedWeight() const {
+            if (queue.empty()) {
+                return std::nullopt;
+            }
+            return queue.front().first;
+        }
+    };
+
+    // Буферы одного запроса, каждый одновременный запрос получает свои из пула
+    struct SearchSpaces {
+        SearchSpace forward;
+        SearchSpace backward;
+
+        explicit SearchSpaces(size_t vertex_count)
+            : forward(vertex_count)
+            , backward(vertex_count) {
+        }
+    };
+
+    struct Neighbour {
+        VertexId vertex;
+        Weight weight;
+        EdgeId edge_id;
+    };
+
+    struct Shortcut {
+        EdgeId first;
+        EdgeId second;
+    };
+
+    // Запись корзины вершины: номер цели и вес пути от вершины до неё
+    struct BucketEntry {
+        size_t target_index;
+        Weight weight;
+    };
+
+    // Полный поиск вверх по иерархии без остановки: visit(vertex, weight) для каждой извлечённой вершины
+    template <typename Visitor>
+    void SearchUpward(SearchSpace& search, VertexId start, bool is_backward, Visitor visit) const;
+
+    void AddContractionEdge(const Edge<Weight>& edge);
+    std::vector<Neighbour> CollectNeighbours(const std::vector<std::vector<EdgeId>>& incidence, VertexId vertex,
+                                             bool is_incoming) const;
+    size_t ContractVertex(VertexId vertex, bool is_dry_run);
+    void ContractGraph();
+    void BuildSearchGraph();
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const size_t original_edge_count_;
+
+    // Исходные рёбра сохраняют свои EdgeId, сокращения получают идентификаторы начиная с original_edge_count_
+    Graph ch_graph_;
+    std::vector<Shortcut> shortcuts_;
+    std::vector<size_t> ranks_;
+
+    // Рёбра к более важным вершинам: исходящие для прямого поиска и входящие для обратного
+    std::vector<std::vector<EdgeId>> upward_edges_;
+    std::vector<std::vector<EdgeId>> downward_edges_;
+
+    // Состояние, нужное только во время стягивания
+    std::vector<std::vector<EdgeId>> incoming_edges_;
+    std::vector<std::vector<EdgeId>> outgoing_edges_;
+    std::vector<bool> is_contracted_;
+    std::vector<size_t> contracted_neighbours_;
+    SearchSpace witness_search_;
+
+    concurrency::ScratchPool<SearchSpaces> search_spaces_;
+};
+
+template <typename Weight>
+ContractionHierarchiesRouter<Weight>::ContractionHierarchiesRouter(const Graph& graph)
+    : original_edge_count_(graph.GetEdgeCount())
+    , ch_graph_(graph.GetVertexCount())
+    , ranks_(graph.GetVertexCount(), 0)
+    , upward_edges_(graph.GetVertexCount())
+    , downward_edges_(graph.GetVertexCount())
+    , incoming_edges_(graph.GetVertexCount())
+    , outgoing_edges_(graph.GetVertexCount())
+    , is_contracted_(graph.GetVertexCount(), false)
+    , contracted_neighbours_(graph.GetVertexCount(), 0)
+    , witness_search_(graph.GetVertexCount())
+    , search_spaces_([vertex_count = graph.GetVertexCount()] {
+        return std::make_unique<SearchSpaces>(vertex_count);
+    })
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        AddContractionEdge(edge);
+    }
+    ContractGraph();
+    BuildSearchGraph();
+}
+
+template <typename Weight>
+void ContractionHierarchiesRouter<Weight>::AddContractionEdge(const Edge<Weight>& edge) {
+    const EdgeId edge_id = ch_graph_.AddEdge(edge);
+    if (edge.from != edge.to) {
+        outgoing_edges_[edge.from].push_back(edge_id);
+        incoming_edges_[edge.to].push_back(edge_id);
+    }
+}
+
+template <typename Weight>
+std::vector<typename ContractionHierarchiesRouter<Weight>::Neighbour>
+ContractionHierarchiesRouter<Weight>::CollectNeighbours(const std::vector<std::vector<EdgeId>>& incidence,
+                                                        VertexId vertex, bool is_incoming) const {
+    std::vector<Neighbour> neighbours;
+    for (const EdgeId edge_id : incidence[vertex]) {
+        const auto& edge = ch_graph_.GetEdge(edge_id);
+        const VertexId neighbour = is_incoming ? edge.from : edge.to;
+        if (!is_contracted_[neighbour]) {
+            neighbours.push_back({neighbour, edge.weight, edge_id});
+        }
+    }
+    // Из параллельных рёбер к одному соседу нужно только самое лёгкое
+    std::sort(neighbours.begin(), neighbours.end(), [](const Neighbour& lhs, const Neighbour& rhs) {
+        return lhs.vertex < rhs.vertex || (lhs.vertex == rhs.vertex && lhs.weight < rhs.weight);
+    });
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end(),
+                                 [](const Neighbour& lhs, const Neighbour& rhs) {
+                                     return lhs.vertex == rhs.vertex;
+                                 }),
+                     neighbours.end());
+    return neighbours;
+}
+
+template <typename Weight>
+size_t ContractionHierarchiesRouter<Weight>::ContractVertex(VertexId vertex, bool is_dry_run) {
+    const std::vector<Neighbour> sources = CollectNeighbours(incoming_edges_, vertex, true);
+    const std::vector<Neighbour> targets = CollectNeighbours(outgoing_edges_, vertex, false);
+    size_t shortcut_count = 0;
+
+    // targets отсортированы по номеру вершины
+    const auto is_target = [&targets](VertexId candidate) {
+        const auto it = std::lower_bound(targets.begin(), targets.end(), candidate,
+                                         [](const Neighbour& neighbour, VertexId value) {
+                                             return neighbour.vertex < value;
+                                         });
+        return it != targets.end() && it->vertex == candidate;
+    };
+
+    for (const Neighbour& source : sources) {
+        if (targets.empty()) {
+            break;
+        }
+        Weight max_weight = ZERO_WEIGHT;
+        for (const Neighbour& target : targets) {
+            max_weight = std::max(max_weight, source.weight + target.weight);
+        }
+
+        // Поиск свидетеля: путь source -> target в оставшемся графе в обход vertex
+        SearchSpace& witness = witness_search_;
+        witness.Start();
+        witness.Reach(source.vertex, ZERO_WEIGHT, std::nullopt);
+        size_t settled_count = 0;
+        size_t unsettled_target_count = targets.size();
+        while (auto item = witness.PopNearest()) {
+            const auto [weight, current] = *item;
+            if (max_weight < weight || ++settled_count > WITNESS_SEARCH_SETTLED_LIMIT) {
+                break;
+            }
+            // Веса до всех соседей-целей окончательны, дальше искать незачем
+            if (is_target(current) && --unsettled_target_count == 0) {
+                break;
+            }
+            for (const EdgeId edge_id : outgoing_edges_[current]) {
+                const auto& edge = ch_graph_.GetEdge(edge_id);
+                if (edge.to == vertex || is_contracted_[edge.to]) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + edge.weight;
+                if (!witness.IsReached(edge.to) || candidate_weight < witness.weights[edge.to]) {
+                    witness.Reach(edge.to, candidate_weight, edge_id);
+                }
+            }
+        }
+
+        for (const Neighbour& target : targets) {
+            if (target.vertex == source.vertex) {
+                continue;
+            }
+            const Weight shortcut_weight = source.weight + target.weight;
+            if (witness.IsReached(target.vertex) && !(shortcut_weight < witness.weights[target.vertex])) {
+                continue;
+            }
+            ++shortcut_count;
+            if (!is_dry_run) {
+                AddContractionEdge({source.vertex, target.vertex, shortcut_weight});
+                shortcuts_.push_back({source.edge_id, target.edge_id});
+            }
+        }
+    }
+
+    if (!is_dry_run) {
+        is_contracted_[vertex] = true;
+        // Рёбра стянутой вершины больше не участвуют ни в поиске свидетелей, ни в подсчёте соседей
+        const auto remove_edges = [this](std::vector<EdgeId>& edges, VertexId vertex_end, bool is_incoming) {
+            edges.erase(std::remove_if(edges.begin(), edges.end(),
+                                       [this, vertex_end, is_incoming](EdgeId edge_id) {
+                                           const auto& edge = ch_graph_.GetEdge(edge_id);
+                                           return (is_incoming ? edge.from : edge.to) == vertex_end;
+                                       }),
+                        edges.end());
+        };
+        for (const Neighbour& neighbour : sources) {
+            ++contracted_neighbours_[neighbour.vertex];
+            remove_edges(outgoing_edges_[neighbour.vertex], vertex, false);
+        }
+        for (const Neighbour& neighbour : targets) {
+            ++contracted_neighbours_[neighbour.vertex];
+            remove_edges(incoming_edges_[neighbour.vertex], vertex, true);
+        }
+        incoming_edges_[vertex].clear();
+        outgoing_edges_[vertex].clear();
+    }
+    return shortcut_count;
+}
+
+template <typename Weight>
+void ContractionHierarchiesRouter<Weight>::ContractGraph() {
+    // Приоритет вершины: разность рёбер (добавленные сокращения минус удалённые рёбра)
+    // плюс число уже стянутых соседей, чтобы стягивание шло равномерно по графу
+    const auto compute_priority = [this](VertexId vertex) {
+        const auto edges_removed = static_cast<std::int64_t>(
+            CollectNeighbours(incoming_edges_, vertex, true).size()
+            + CollectNeighbours(outgoing_edges_, vertex, false).size());
+        const auto shortcuts_added = static_cast<std::int64_t>(ContractVertex(vertex, true));
+        return shortcuts_added - edges_removed + static_cast<std::int64_t>(contracted_neighbours_[vertex]);
+    };
+
+    using PriorityItem = std::pair<std::int64_t, VertexId>;
+    std::vector<PriorityItem> queue;
+    const size_t vertex_count = ch_graph_.GetVertexCount();
+    queue.reserve(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        queue.emplace_back(compute_priority(vertex), vertex);
+    }
+    std::make_heap(queue.begin(), queue.end(), std::greater<PriorityItem>{});
+
+    size_t rank = 0;
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<PriorityItem>{});
+        const VertexId vertex = queue.back().second;
+        queue.pop_back();
+
+        // Ленивое обновление: если приоритет вырос и вершина больше не минимальна, откладываем её
+        const std::int64_t priority = compute_priority(vertex);
+        if (!queue.empty() && queue.front().first < priority) {
+            queue.emplace_back(priority, vertex);
+            std::push_heap(queue.begin(), queue.end(), std::greater<PriorityItem>{});
+            continue;
+        }
+        ContractVertex(vertex, false);
+        ranks_[vertex] = rank++;
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchiesRouter<Weight>::BuildSearchGraph() {
+    for (EdgeId edge_id = 0; edge_id < ch_graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = ch_graph_.GetEdge(edge_id);
+        if (edge.from == edge.to) {
+            continue;
+        }
+        if (ranks_[edge.from] < ranks_[edge.to]) {
+            upward_edges_[edge.from].push_back(edge_id);
+        } else {
+            downward_edges_[edge.to].push_back(edge_id);
+        }
+    }
+    incoming_edges_.clear();
+    incoming_edges_.shrink_to_fit();
+    outgoing_edges_.clear();
+    outgoing_edges_.shrink_to_fit();
+    is_contracted_.clear();
+    is_contracted_.shrink_to_fit();
+    contracted_neighbours_.clear();
+    contracted_neighbours_.shrink_to_fit();
+    witness_search_ = SearchSpace(0);
+}
+
+template <typename Weight>
+void ContractionHierarchiesRouter<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+    std::vector<EdgeId> stack{edge_id};
+    while (!stack.empty()) {
+        const EdgeId current = stack.back();
+        stack.pop_back();
+        if (current < original_edge_count_) {
+            edges.push_back(current);
+        } else {
+            const Shortcut& shortcut = shortcuts_[current - original_edge_count_];
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchiesRouter<Weight>::RouteInfo>
+ContractionHierarchiesRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= ch_graph_.GetVertexCount() || to >= ch_graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+    const auto search_spaces = search_spaces_.Acquire();
+    SearchSpace& forward_search = search_spaces->forward;
+    SearchSpace& backward_search = search_spaces->backward;
+    forward_search.Start();
+    forward_search.Reach(from, ZERO_WEIGHT, std::nullopt);
+    backward_search.Start();
+    backward_search.Reach(to, ZERO_WEIGHT, std::nullopt);
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+    const auto update_best = [&](VertexId vertex) {
+        if (forward_search.IsReached(vertex) && backward_search.IsReached(vertex)) {
+            const Weight weight = forward_search.weights[vertex] + backward_search.weights[vertex];
+            if (!best_weight || weight < *best_weight) {
+                best_weight = weight;
+                meeting_vertex = vertex;
+            }
+        }
+    };
+    // Направление поиска продолжается, пока его очередь может улучшить лучший найденный путь
+    const auto is_worth_continuing = [&](const SearchSpace& search) {
+        const auto min_weight = search.MinQueuedWeight();
+        return min_weight && (!best_weight || *min_weight < *best_weight);
+    };
+
+    while (is_worth_continuing(forward_search) || is_worth_continuing(backward_search)) {
+        if (is_worth_continuing(forward_search)) {
+            if (const auto item = forward_search.PopNearest()) {
+                const auto [weight, vertex] = *item;
+                update_best(vertex);
+                for (const EdgeId edge_id : upward_edges_[vertex]) {
+                    const auto& edge = ch_graph_.GetEdge(edge_id);
+                    const Weight candidate_weight = weight + edge.weight;
+                    if (!forward_search.IsReached(edge.to) || candidate_weight < forward_search.weights[edge.to]) {
+                        forward_search.Reach(edge.to, candidate_weight, edge_id);
+                        update_best(edge.to);
+                    }
+                }
+            }
+        }
+        if (is_worth_continuing(backward_search)) {
+            if (const auto item = backward_search.PopNearest()) {
+                const auto [weight, vertex] = *item;
+                update_best(vertex);
+                for (const EdgeId edge_id : downward_edges_[vertex]) {
+                    const auto& edge = ch_graph_.GetEdge(edge_id);
+                    const Weight candidate_weight = weight + edge.weight;
+                    if (!backward_search.IsReached(edge.from)
+                        || candidate_weight < backward_search.weights[edge.from]) {
+                        backward_search.Reach(edge.from, candidate_weight, edge_id);
+                        update_best(edge.from);
+                    }
+                }
+            }
+        }
+    }
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> ch_edges;
+    for (std::optional<EdgeId> edge_id = forward_search.prev_edges[meeting_vertex];
+         edge_id;
+         edge_id = forward_search.prev_edges[ch_graph_.GetEdge(*edge_id).from])
+    {
+        ch_edges.push_back(*edge_id);
+    }
+    std::reverse(ch_edges.begin(), ch_edges.end());
+    for (std::optional<EdgeId> edge_id = backward_search.prev_edges[meeting_vertex];
+         edge_id;
+         edge_id = backward_search.prev_edges[ch_graph_.GetEdge(*edge_id).to])
+    {
+        ch_edges.push_back(*edge_id);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId edge_id : ch_edges) {
+        UnpackEdge(edge_id, edges);
+    }
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+template <typename Weight>
+template <typename Visitor>
+void ContractionHierarchiesRouter<Weight>::SearchUpward(SearchSpace& search, VertexId start, bool is_backward,
+                                                        Visitor visit) const {
+    search.Start();
+    search.Reach(start, ZERO_WEIGHT, std::nullopt);
+    while (const auto item = search.PopNearest()) {
+        const auto [weight, vertex] = *item;
+        visit(vertex, weight);
+        for (const EdgeId edge_id : is_backward ? downward_edges_[vertex] : upward_edges_[vertex]) {
+            const auto& edge = ch_graph_.GetEdge(edge_id);
+            const VertexId next_vertex = is_backward ? edge.from : edge.to;
+            const Weight candidate_weight = weight + edge.weight;
+            if (!search.IsReached(next_vertex) || candidate_weight < search.weights[next_vertex]) {
+                search.Reach(next_vertex, candidate_weight, edge_id);
+            }
+        }
+    }
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> ContractionHierarchiesRouter<Weight>::BuildWeightsMatrix(
+    const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+    for (const VertexId vertex : sources) {
+        if (vertex >= ch_graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of graph");
+        }
+    }
+    const auto search_spaces = search_spaces_.Acquire();
+    std::vector<std::vector<BucketEntry>> buckets(ch_graph_.GetVertexCount());
+    for (size_t target_index = 0; target_index < targets.size(); ++target_index) {
+        if (targets[target_index] >= ch_graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of graph");
+        }
+        SearchUpward(search_spaces->backward, targets[target_index], true, [&](VertexId vertex, Weight weight) {
+            buckets[vertex].push_back({target_index, weight});
+        });
+    }
+
+    std::vector<std::optional<Weight>> result(sources.size() * targets.size());
+    for (size_t source_index = 0; source_index < sources.size(); ++source_index) {
+        std::optional<Weight>* row = result.data() + source_index * targets.size();
+        SearchUpward(search_spaces->forward, sources[source_index], false, [&](VertexId vertex, Weight weight) {
+            for (const auto& [target_index, bucket_weight] : buckets[vertex]) {
+                const Weight candidate_weight = weight + bucket_weight;
+                if (!row[target_index] || candidate_weight < *row[target_index]) {
+                    row[target_index] = candidate_weight;
+                }
+            }
+        });
+    }
+    return result;
+}
+
+}  // namespace graph
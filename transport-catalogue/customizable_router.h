@@ -0,0 +1,619 @@
+#pragma once
+
+#include "parallel_for.h"
+#include "ranges.h"
+#include "router.h"
+#include "scratch_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Маршрутизация с настраиваемой метрикой в стиле CRP (customizable route planning).
+// Предрасчёт разделён на две фазы:
+// - разбиение графа на вложенные ячейки нескольких уровней зависит только от его топологии
+//   и выполняется один раз при создании движка;
+// - настройка считает для каждой ячейки веса кратчайших путей внутри неё от входных вершин
+//   до выходных (клику ячейки). Ячейки нижнего уровня настраиваются по рёбрам графа,
+//   ячейки следующих уровней - по кликам вложенных ячеек, ячейки одного уровня - параллельно.
+// При изменении весов заново настраиваются только ячейки, внутри которых лежат изменённые рёбра.
+// Запрос - поиск Дейкстры, который проходит рёбра графа только в ячейках нижнего уровня
+// с началом и концом маршрута, а остальной граф - по кликам самых крупных ячеек, не содержащих
+// ни начала, ни конца. Рёбра клик раскрываются в рёбра графа поиском внутри своей ячейки.
+// Граф должен быть заморожен. Запросы можно выполнять из нескольких потоков одновременно.
+template <typename Weight>
+class CustomizableRouter final : public RouterEngine<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+
+    // thread_count потоков делят между собой ячейки каждого уровня при настройке
+    explicit CustomizableRouter(const Graph& graph, size_t thread_count = 1);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Разбиение не меняется, заново настраиваются ячейки, внутри которых лежат изменённые рёбра
+    bool UpdateEdgeWeights(const std::vector<EdgeWeightChange<Weight>>& changes) override;
+
+private:
+    using CellId = std::uint32_t;
+    using QueueItem = std::pair<Weight, VertexId>;
+
+    static constexpr std::uint32_t NO_INDEX = std::numeric_limits<std::uint32_t>::max();
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+                                              ? std::numeric_limits<Weight>::infinity()
+                                              : std::numeric_limits<Weight>::max() / 2;
+    // Наибольшее число вершин в ячейке нижнего уровня; на каждом следующем уровне оно
+    // в CELL_SIZE_FACTOR раз больше. Уровни добавляются, пока ячейка уровня меньше графа
+    static constexpr size_t BASE_CELL_SIZE = 256;
+    static constexpr size_t CELL_SIZE_FACTOR = 4;
+    static constexpr size_t MAX_LEVEL_COUNT = 3;
+
+    // Внутри движка вершины перенумерованы в порядке разбиения, так что вершины каждой ячейки
+    // идут подряд, а рёбра хранятся в собственном CSR-массиве с весами в новой нумерации
+    struct LocalEdge {
+        VertexId to;
+        Weight weight;
+        EdgeId id;
+    };
+
+    // Входные вершины ячейки - концы рёбер из других ячеек уровня, выходные - начала рёбер в другие.
+    // Клика - веса путей внутри ячейки: weights[entry * exits.size() + exit]
+    struct Cell {
+        std::vector<VertexId> entries;
+        std::vector<VertexId> exits;
+        std::vector<Weight> weights;
+    };
+
+    struct Level {
+        std::vector<CellId> vertex_cells;
+        // Номер вершины среди входных и выходных вершин её ячейки или NO_INDEX
+        std::vector<std::uint32_t> entry_indexes;
+        std::vector<std::uint32_t> exit_indexes;
+        std::vector<Cell> cells;
+    };
+
+    // Отрезок [begin, end) порядка вершин при рекурсивном делении графа и размер отрезка, который делили
+    struct PartitionRange {
+        size_t begin;
+        size_t end;
+        size_t parent_size;
+    };
+
+    // Дуга, по которой поиск пришёл в вершину: ребро графа или ребро клики уровня shortcut_level
+    struct Arc {
+        VertexId from;
+        EdgeId edge;
+        std::optional<size_t> shortcut_level;
+    };
+
+    // Дуга пути вместе с вершиной, в которую она ведёт
+    struct PathArc {
+        Arc arc;
+        VertexId to;
+    };
+
+    // Буферы поиска. Вершина считается достигнутой в текущем поиске, если её метка равна current_stamp.
+    // Метка и вес вершины лежат рядом: при проходе по клике они читаются одним обращением к памяти
+    struct SearchSpace {
+        struct VertexState {
+            Weight weight;
+            std::uint32_t stamp = 0;
+        };
+
+        std::uint32_t current_stamp = 0;
+        std::vector<VertexState> states;
+        std::vector<Arc> arcs;
+        std::vector<QueueItem> queue;
+
+        explicit SearchSpace(size_t vertex_count)
+            : states(vertex_count)
+            , arcs(vertex_count) {
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return states[vertex].stamp == current_stamp;
+        }
+
+        Weight GetWeight(VertexId vertex) const {
+            return states[vertex].weight;
+        }
+
+        void Start() {
+            if (++current_stamp == 0) {
+                for (VertexState& state : states) {
+                    state.stamp = 0;
+                }
+                current_stamp = 1;
+            }
+            queue.clear();
+        }
+
+        void Relax(VertexId vertex, Weight weight, const Arc& arc) {
+            VertexState& state = states[vertex];
+            if (state.stamp == current_stamp && !(weight < state.weight)) {
+                return;
+            }
+            state = VertexState{weight, current_stamp};
+            arcs[vertex] = arc;
+            queue.emplace_back(weight, vertex);
+            std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        }
+
+        // Следующая вершина с окончательным весом или пусто, если очередь исчерпана
+        std::optional<QueueItem> Settle() {
+            while (!queue.empty()) {
+                std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+                const QueueItem item = queue.back();
+                queue.pop_back();
+                if (!(states[item.second].weight < item.first)) {
+                    return item;
+                }
+            }
+            return std::nullopt;
+        }
+    };
+
+    void CheckVertex(VertexId vertex) const {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of graph");
+        }
+    }
+
+    auto GetLocalEdges(VertexId vertex) const {
+        return ranges::Range{local_edges_.begin() + edges_offsets_[vertex],
+                             local_edges_.begin() + edges_offsets_[vertex + 1]};
+    }
+
+    void BuildPartition();
+
+    // Делит отрезок order пополам и рекурсивно делит половины, пока они больше BASE_CELL_SIZE.
+    // Все отрезки деления записываются в ranges сверху вниз
+    static void BisectRange(const PartitionRange& range, const std::vector<std::vector<VertexId>>& adjacency,
+                            std::vector<VertexId>& order, std::vector<std::uint32_t>& marks,
+                            std::vector<PartitionRange>& ranges);
+
+    void BuildLocalEdges(const std::vector<VertexId>& order);
+
+    void FindBoundaryVertexes(Level& level, size_t cell_count) const;
+
+    // Настраивает ячейки cells_by_level[level] снизу вверх
+    void Customize(const std::vector<std::vector<CellId>>& cells_by_level);
+
+    void CustomizeCell(size_t level_index, CellId cell_id, SearchSpace& space);
+
+    // Поиск внутри ячейки cell_id уровня level_index по кликам вложенных ячеек, а на нижнем уровне -
+    // по рёбрам графа. Останавливается, когда достигнута вершина target
+    void SearchInCell(size_t level_index, CellId cell_id, VertexId source, std::optional<VertexId> target,
+                      SearchSpace& space) const;
+
+    void RelaxShortcuts(size_t level_index, VertexId vertex, Weight weight, SearchSpace& space) const;
+
+    // Номер уровня на единицу больше того, по кликам которого проходит запрос в вершине vertex;
+    // 0 - вершина в одной ячейке нижнего уровня с началом или концом, она проходится по рёбрам графа
+    size_t GetQueryLevel(VertexId vertex, VertexId from, VertexId to) const;
+
+    // Дуги пути от source до target по последнему поиску
+    static std::vector<PathArc> CollectArcs(const SearchSpace& space, VertexId source, VertexId target);
+
+    void UnpackArcs(const std::vector<PathArc>& arcs, std::vector<EdgeId>& edges, SearchSpace& space) const;
+
+    const Graph& graph_;
+    const size_t thread_count_;
+    // Номер вершины графа внутри движка
+    std::vector<VertexId> vertex_positions_;
+    std::vector<size_t> edges_offsets_;
+    std::vector<LocalEdge> local_edges_;
+    // Положение ребра графа в local_edges_
+    std::vector<size_t> edge_positions_;
+    std::vector<Level> levels_;
+    concurrency::ScratchPool<SearchSpace> search_spaces_;
+};
+
+template <typename Weight>
+CustomizableRouter<Weight>::CustomizableRouter(const Graph& graph, size_t thread_count)
+    : graph_(graph)
+    , thread_count_(std::max<size_t>(thread_count, 1))
+    , search_spaces_([vertex_count = graph.GetVertexCount()] {
+        return std::make_unique<SearchSpace>(vertex_count);
+    })
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    if (graph.GetVertexCount() >= NO_INDEX) {
+        throw std::length_error("Graph is too large for customizable route planning");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    BuildPartition();
+    std::vector<std::vector<CellId>> cells_by_level(levels_.size());
+    for (size_t level_index = 0; level_index < levels_.size(); ++level_index) {
+        for (CellId cell_id = 0; cell_id < levels_[level_index].cells.size(); ++cell_id) {
+            cells_by_level[level_index].push_back(cell_id);
+        }
+    }
+    Customize(cells_by_level);
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::BuildPartition() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    // Для разбиения направление рёбер не важно
+    std::vector<std::vector<VertexId>> adjacency(vertex_count);
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        adjacency[edge.from].push_back(edge.to);
+        adjacency[edge.to].push_back(edge.from);
+    }
+    std::vector<VertexId> order(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order[vertex] = vertex;
+    }
+    std::vector<PartitionRange> ranges;
+    std::vector<std::uint32_t> marks(vertex_count, 0);
+    BisectRange(PartitionRange{0, vertex_count, std::numeric_limits<size_t>::max()}, adjacency, order, marks, ranges);
+    BuildLocalEdges(order);
+
+    // Ячейка уровня - наибольший отрезок деления, который не больше предела уровня
+    size_t max_cell_size = BASE_CELL_SIZE;
+    while (levels_.size() < MAX_LEVEL_COUNT && max_cell_size < vertex_count) {
+        Level level;
+        level.vertex_cells.resize(vertex_count);
+        size_t cell_count = 0;
+        for (const PartitionRange& range : ranges) {
+            if (range.end - range.begin <= max_cell_size && range.parent_size > max_cell_size) {
+                std::fill(level.vertex_cells.begin() + range.begin, level.vertex_cells.begin() + range.end,
+                          static_cast<CellId>(cell_count++));
+            }
+        }
+        FindBoundaryVertexes(level, cell_count);
+        levels_.push_back(std::move(level));
+        max_cell_size *= CELL_SIZE_FACTOR;
+    }
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::BisectRange(const PartitionRange& range,
+                                             const std::vector<std::vector<VertexId>>& adjacency,
+                                             std::vector<VertexId>& order, std::vector<std::uint32_t>& marks,
+                                             std::vector<PartitionRange>& ranges) {
+    ranges.push_back(range);
+    const size_t size = range.end - range.begin;
+    if (size <= BASE_CELL_SIZE) {
+        return;
+    }
+    // Вершины отрезка получают метку, своя у каждого отрезка, и обход в ширину не выходит за отрезок
+    const auto mark = static_cast<std::uint32_t>(2 * ranges.size());
+    for (size_t position = range.begin; position < range.end; ++position) {
+        marks[order[position]] = mark;
+    }
+    const auto run_bfs = [&](VertexId source, std::vector<VertexId>& visited) {
+        const size_t first = visited.size();
+        marks[source] = 0;
+        visited.push_back(source);
+        for (size_t position = first; position < visited.size(); ++position) {
+            for (const VertexId neighbour : adjacency[visited[position]]) {
+                if (marks[neighbour] == mark) {
+                    marks[neighbour] = 0;
+                    visited.push_back(neighbour);
+                }
+            }
+        }
+    };
+    // Обход от самой дальней вершины компоненты упорядочивает её вершины слоями,
+    // так что любой префикс порядка - связный кусок с одного края. Несвязанные компоненты идут следом
+    std::vector<VertexId> visited;
+    visited.reserve(size);
+    for (size_t position = range.begin; position < range.end; ++position) {
+        const VertexId vertex = order[position];
+        if (marks[vertex] != mark) {
+            continue;
+        }
+        const size_t first = visited.size();
+        run_bfs(vertex, visited);
+        const VertexId peripheral = visited.back();
+        for (size_t index = first; index < visited.size(); ++index) {
+            marks[visited[index]] = mark;
+        }
+        visited.resize(first);
+        run_bfs(peripheral, visited);
+    }
+    std::copy(visited.begin(), visited.end(), order.begin() + range.begin);
+
+    // Отрезок делится там, где между частями меньше всего рёбер, но части отличаются не больше чем в полтора раза.
+    // Вершины переходят в первую часть по одной, метка отличает вершины первой части от второй
+    const auto first_part_mark = mark + 1;
+    for (size_t position = range.begin; position < range.end; ++position) {
+        marks[order[position]] = mark;
+    }
+    long long cut_size = 0;
+    long long best_cut_size = std::numeric_limits<long long>::max();
+    size_t middle = range.begin + size / 2;
+    const size_t split_begin = range.begin + size * 2 / 5;
+    const size_t split_end = range.begin + size * 3 / 5;
+    for (size_t position = range.begin; position < split_end; ++position) {
+        const VertexId vertex = order[position];
+        for (const VertexId neighbour : adjacency[vertex]) {
+            if (marks[neighbour] == mark) {
+                ++cut_size;
+            } else if (marks[neighbour] == first_part_mark) {
+                --cut_size;
+            }
+        }
+        marks[vertex] = first_part_mark;
+        if (position + 1 >= split_begin && cut_size < best_cut_size) {
+            best_cut_size = cut_size;
+            middle = position + 1;
+        }
+    }
+
+    BisectRange(PartitionRange{range.begin, middle, size}, adjacency, order, marks, ranges);
+    BisectRange(PartitionRange{middle, range.end, size}, adjacency, order, marks, ranges);
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::BuildLocalEdges(const std::vector<VertexId>& order) {
+    const size_t vertex_count = graph_.GetVertexCount();
+    vertex_positions_.resize(vertex_count);
+    for (VertexId position = 0; position < vertex_count; ++position) {
+        vertex_positions_[order[position]] = position;
+    }
+    edges_offsets_.reserve(vertex_count + 1);
+    edges_offsets_.push_back(0);
+    local_edges_.reserve(graph_.GetEdgeCount());
+    edge_positions_.resize(graph_.GetEdgeCount());
+    for (VertexId position = 0; position < vertex_count; ++position) {
+        for (const auto& edge : graph_.GetOutgoingEdges(order[position])) {
+            edge_positions_[edge.id] = local_edges_.size();
+            local_edges_.push_back(LocalEdge{vertex_positions_[edge.to], edge.weight, edge.id});
+        }
+        edges_offsets_.push_back(local_edges_.size());
+    }
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::FindBoundaryVertexes(Level& level, size_t cell_count) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<bool> is_entry(vertex_count, false);
+    std::vector<bool> is_exit(vertex_count, false);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (const LocalEdge& edge : GetLocalEdges(vertex)) {
+            if (level.vertex_cells[vertex] != level.vertex_cells[edge.to]) {
+                is_exit[vertex] = true;
+                is_entry[edge.to] = true;
+            }
+        }
+    }
+    level.cells.resize(cell_count);
+    level.entry_indexes.assign(vertex_count, NO_INDEX);
+    level.exit_indexes.assign(vertex_count, NO_INDEX);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        Cell& cell = level.cells[level.vertex_cells[vertex]];
+        if (is_entry[vertex]) {
+            level.entry_indexes[vertex] = static_cast<std::uint32_t>(cell.entries.size());
+            cell.entries.push_back(vertex);
+        }
+        if (is_exit[vertex]) {
+            level.exit_indexes[vertex] = static_cast<std::uint32_t>(cell.exits.size());
+            cell.exits.push_back(vertex);
+        }
+    }
+    for (Cell& cell : level.cells) {
+        cell.weights.assign(cell.entries.size() * cell.exits.size(), INFINITE_WEIGHT);
+    }
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::Customize(const std::vector<std::vector<CellId>>& cells_by_level) {
+    for (size_t level_index = 0; level_index < cells_by_level.size(); ++level_index) {
+        // Ячейки уровня зависят только от клик уровня ниже, поэтому настраиваются независимо
+        const std::vector<CellId>& cells = cells_by_level[level_index];
+        concurrency::ParallelFor(cells.size(), thread_count_, [this, &cells, level_index] {
+            // У каждого потока свой буфер поиска
+            return [this, &cells, level_index,
+                    space = SearchSpace(graph_.GetVertexCount())](size_t cell_index) mutable {
+                CustomizeCell(level_index, cells[cell_index], space);
+            };
+        });
+    }
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::CustomizeCell(size_t level_index, CellId cell_id, SearchSpace& space) {
+    Cell& cell = levels_[level_index].cells[cell_id];
+    const size_t exit_count = cell.exits.size();
+    for (size_t entry_index = 0; entry_index < cell.entries.size(); ++entry_index) {
+        SearchInCell(level_index, cell_id, cell.entries[entry_index], std::nullopt, space);
+        for (size_t exit_index = 0; exit_index < exit_count; ++exit_index) {
+            const VertexId exit = cell.exits[exit_index];
+            cell.weights[entry_index * exit_count + exit_index] =
+                space.IsReached(exit) ? space.GetWeight(exit) : INFINITE_WEIGHT;
+        }
+    }
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::SearchInCell(size_t level_index, CellId cell_id, VertexId source,
+                                              std::optional<VertexId> target, SearchSpace& space) const {
+    const std::vector<CellId>& vertex_cells = levels_[level_index].vertex_cells;
+    space.Start();
+    space.Relax(source, ZERO_WEIGHT, Arc{source, 0, std::nullopt});
+    while (const auto item = space.Settle()) {
+        const auto [weight, vertex] = *item;
+        if (vertex == target) {
+            return;
+        }
+        if (level_index == 0) {
+            for (const LocalEdge& edge : GetLocalEdges(vertex)) {
+                if (vertex_cells[edge.to] == cell_id) {
+                    space.Relax(edge.to, weight + edge.weight, Arc{vertex, edge.id, std::nullopt});
+                }
+            }
+            continue;
+        }
+        // Внутри вложенной ячейки путь идёт по её клике, между вложенными ячейками - по рёбрам графа
+        const Level& sublevel = levels_[level_index - 1];
+        RelaxShortcuts(level_index - 1, vertex, weight, space);
+        if (sublevel.exit_indexes[vertex] == NO_INDEX) {
+            continue;
+        }
+        for (const LocalEdge& edge : GetLocalEdges(vertex)) {
+            if (vertex_cells[edge.to] == cell_id && sublevel.vertex_cells[edge.to] != sublevel.vertex_cells[vertex]) {
+                space.Relax(edge.to, weight + edge.weight, Arc{vertex, edge.id, std::nullopt});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::RelaxShortcuts(size_t level_index, VertexId vertex, Weight weight,
+                                                SearchSpace& space) const {
+    const Level& level = levels_[level_index];
+    const std::uint32_t entry_index = level.entry_indexes[vertex];
+    if (entry_index == NO_INDEX) {
+        return;
+    }
+    const Cell& cell = level.cells[level.vertex_cells[vertex]];
+    const size_t exit_count = cell.exits.size();
+    for (size_t exit_index = 0; exit_index < exit_count; ++exit_index) {
+        const Weight shortcut_weight = cell.weights[entry_index * exit_count + exit_index];
+        if (shortcut_weight < INFINITE_WEIGHT) {
+            space.Relax(cell.exits[exit_index], weight + shortcut_weight, Arc{vertex, 0, level_index});
+        }
+    }
+}
+
+template <typename Weight>
+size_t CustomizableRouter<Weight>::GetQueryLevel(VertexId vertex, VertexId from, VertexId to) const {
+    for (size_t level_index = levels_.size(); level_index > 0; --level_index) {
+        const std::vector<CellId>& vertex_cells = levels_[level_index - 1].vertex_cells;
+        if (vertex_cells[vertex] != vertex_cells[from] && vertex_cells[vertex] != vertex_cells[to]) {
+            return level_index;
+        }
+    }
+    return 0;
+}
+
+template <typename Weight>
+std::optional<typename CustomizableRouter<Weight>::RouteInfo> CustomizableRouter<Weight>::BuildRoute(
+    VertexId from, VertexId to) const {
+    CheckVertex(from);
+    CheckVertex(to);
+    const VertexId source = vertex_positions_[from];
+    const VertexId target = vertex_positions_[to];
+    const auto space = search_spaces_.Acquire();
+    space->Start();
+    space->Relax(source, ZERO_WEIGHT, Arc{source, 0, std::nullopt});
+    while (const auto item = space->Settle()) {
+        const auto [weight, vertex] = *item;
+        if (vertex == target) {
+            break;
+        }
+        const size_t query_level = GetQueryLevel(vertex, source, target);
+        if (query_level == 0) {
+            for (const LocalEdge& edge : GetLocalEdges(vertex)) {
+                space->Relax(edge.to, weight + edge.weight, Arc{vertex, edge.id, std::nullopt});
+            }
+            continue;
+        }
+        // Ячейка вершины не содержит ни начала, ни конца: сквозь неё путь идёт по клике,
+        // а покидает её по рёбрам графа между ячейками этого уровня
+        const size_t level_index = query_level - 1;
+        const std::vector<CellId>& vertex_cells = levels_[level_index].vertex_cells;
+        RelaxShortcuts(level_index, vertex, weight, *space);
+        if (levels_[level_index].exit_indexes[vertex] == NO_INDEX) {
+            continue;
+        }
+        for (const LocalEdge& edge : GetLocalEdges(vertex)) {
+            if (vertex_cells[edge.to] != vertex_cells[vertex]) {
+                space->Relax(edge.to, weight + edge.weight, Arc{vertex, edge.id, std::nullopt});
+            }
+        }
+    }
+    if (!space->IsReached(target)) {
+        return std::nullopt;
+    }
+    const Weight weight = space->GetWeight(target);
+    std::vector<EdgeId> edges;
+    UnpackArcs(CollectArcs(*space, source, target), edges, *space);
+    return RouteInfo{weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::vector<typename CustomizableRouter<Weight>::PathArc> CustomizableRouter<Weight>::CollectArcs(
+    const SearchSpace& space, VertexId source, VertexId target) {
+    std::vector<PathArc> arcs;
+    for (VertexId vertex = target; vertex != source; vertex = space.arcs[vertex].from) {
+        arcs.push_back(PathArc{space.arcs[vertex], vertex});
+    }
+    std::reverse(arcs.begin(), arcs.end());
+    return arcs;
+}
+
+template <typename Weight>
+void CustomizableRouter<Weight>::UnpackArcs(const std::vector<PathArc>& arcs, std::vector<EdgeId>& edges,
+                                            SearchSpace& space) const {
+    for (const auto& [arc, arc_to] : arcs) {
+        if (!arc.shortcut_level) {
+            edges.push_back(arc.edge);
+            continue;
+        }
+        const size_t level_index = *arc.shortcut_level;
+        // Поиск повторяет настройку ячейки, поэтому находит путь того же веса, что и в клике
+        SearchInCell(level_index, levels_[level_index].vertex_cells[arc.from], arc.from, arc_to, space);
+        UnpackArcs(CollectArcs(space, arc.from, arc_to), edges, space);
+    }
+}
+
+template <typename Weight>
+bool CustomizableRouter<Weight>::UpdateEdgeWeights(const std::vector<EdgeWeightChange<Weight>>& changes) {
+    for (const auto& change : changes) {
+        if (graph_.GetEdge(change.edge_id).weight < ZERO_WEIGHT) {
+            return false;
+        }
+    }
+    std::vector<std::vector<bool>> is_cell_changed(levels_.size());
+    for (size_t level_index = 0; level_index < levels_.size(); ++level_index) {
+        is_cell_changed[level_index].assign(levels_[level_index].cells.size(), false);
+    }
+    for (const auto& change : changes) {
+        const auto& edge = graph_.GetEdge(change.edge_id);
+        local_edges_[edge_positions_[change.edge_id]].weight = edge.weight;
+        // Ребро внутри ячейки уровня лежит и внутри всех объемлющих её ячеек
+        const VertexId from = vertex_positions_[edge.from];
+        const VertexId to = vertex_positions_[edge.to];
+        for (size_t level_index = 0; level_index < levels_.size(); ++level_index) {
+            const std::vector<CellId>& vertex_cells = levels_[level_index].vertex_cells;
+            if (vertex_cells[from] == vertex_cells[to]) {
+                is_cell_changed[level_index][vertex_cells[from]] = true;
+            }
+        }
+    }
+    std::vector<std::vector<CellId>> cells_by_level(levels_.size());
+    for (size_t level_index = 0; level_index < levels_.size(); ++level_index) {
+        for (CellId cell_id = 0; cell_id < is_cell_changed[level_index].size(); ++cell_id) {
+            if (is_cell_changed[level_index][cell_id]) {
+                cells_by_level[level_index].push_back(cell_id);
+            }
+        }
+    }
+    Customize(cells_by_level);
+    return true;
+}
+
+}  // namespace graph
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "router.h"
+#include "scratch_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Поиск маршрута по запросу алгоритмом Дейкстры без предрасчёта.
+// Память линейна по размеру графа, буферы поиска переиспользуются между запросами.
+// Запросы можно выполнять из нескольких потоков одновременно: у каждого свои буферы из пула.
+// Граф должен быть заморожен: рёбра перебираются по его CSR-представлению.
+template <typename Weight>
+class DijkstraRouter final : public RouterEngine<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+
+    explicit DijkstraRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Один поиск от from, который останавливается, как только достигнуты все цели
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override;
+
+    // Все вершины, до которых есть маршрут весом не больше max_weight, вместе с весами маршрутов
+    // в порядке их возрастания. Поиск останавливается, как только бюджет превышен
+    std::vector<std::pair<VertexId, Weight>> BuildReachable(VertexId from, Weight max_weight) const;
+
+    // Предрасчёта нет, веса читаются из графа при каждом запросе
+    bool UpdateEdgeWeights(const std::vector<EdgeWeightChange<Weight>>& changes) override {
+        for (const auto& change : changes) {
+            if (graph_.GetEdge(change.edge_id).weight < ZERO_WEIGHT) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    using QueueItem = std::pair<Weight, VertexId>;
+
+    // Буферы поиска. Вершина считается посещённой в текущем поиске, если её метка равна current_stamp.
+    // Это позволяет не очищать буферы перед каждым запросом.
+    struct SearchSpace {
+        std::uint32_t current_stamp = 0;
+        std::vector<std::uint32_t> stamps;
+        // Вершина - ещё не достигнутая цель текущего поиска, если её метка равна current_stamp
+        std::vector<std::uint32_t> target_stamps;
+        std::vector<Weight> weights;
+        std::vector<std::optional<EdgeId>> prev_edges;
+        std::vector<QueueItem> queue;
+
+        explicit SearchSpace(size_t vertex_count)
+            : stamps(vertex_count, 0)
+            , target_stamps(vertex_count, 0)
+            , weights(vertex_count)
+            , prev_edges(vertex_count) {
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return stamps[vertex] == current_stamp;
+        }
+
+        void Start() {
+            if (++current_stamp == 0) {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                std::fill(target_stamps.begin(), target_stamps.end(), 0);
+                current_stamp = 1;
+            }
+            queue.clear();
+        }
+
+        void Reach(VertexId vertex, Weight weight, std::optional<EdgeId> prev_edge) {
+            stamps[vertex] = current_stamp;
+            weights[vertex] = weight;
+            prev_edges[vertex] = prev_edge;
+            queue.emplace_back(weight, vertex);
+            std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        }
+    };
+
+    void CheckVertex(VertexId vertex) const {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of graph");
+        }
+    }
+
+    // Маршрут до вершины, найденной поиском search
+    RouteInfo ExtractRoute(const SearchSpace& search, VertexId to) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    concurrency::ScratchPool<SearchSpace> search_spaces_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+    : graph_(graph)
+    , search_spaces_([vertex_count = graph.GetVertexCount()] {
+        return std::make_unique<SearchSpace>(vertex_count);
+    })
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    return std::move(BuildRoutes(from, {to}).front());
+}
+
+template <typename Weight>
+std::vector<std::optional<typename DijkstraRouter<Weight>::RouteInfo>> DijkstraRouter<Weight>::BuildRoutes(
+    VertexId from, const std::vector<VertexId>& targets) const {
+    CheckVertex(from);
+    for (const VertexId to : targets) {
+        CheckVertex(to);
+    }
+    const auto search = search_spaces_.Acquire();
+    search->Start();
+    size_t targets_left = 0;
+    for (const VertexId to : targets) {
+        if (search->target_stamps[to] != search->current_stamp) {
+            search->target_stamps[to] = search->current_stamp;
+            ++targets_left;
+        }
+    }
+    search->Reach(from, ZERO_WEIGHT, std::nullopt);
+
+    while (!search->queue.empty() && targets_left > 0) {
+        std::pop_heap(search->queue.begin(), search->queue.end(), std::greater<QueueItem>{});
+        const auto [weight, vertex] = search->queue.back();
+        search->queue.pop_back();
+        if (search->weights[vertex] < weight) {
+            // Устаревшая запись очереди: вершина уже достигнута более коротким путём
+            continue;
+        }
+        if (search->target_stamps[vertex] == search->current_stamp) {
+            search->target_stamps[vertex] = 0;
+            --targets_left;
+        }
+        for (const auto& edge : graph_.GetOutgoingEdges(vertex)) {
+            const Weight candidate_weight = weight + edge.weight;
+            if (!search->IsReached(edge.to) || candidate_weight < search->weights[edge.to]) {
+                search->Reach(edge.to, candidate_weight, edge.id);
+            }
+        }
+    }
+
+    // Поиск останавливается только после извлечения всех целей, поэтому веса достигнутых целей окончательные
+    std::vector<std::optional<RouteInfo>> result;
+    result.reserve(targets.size());
+    for (const VertexId to : targets) {
+        if (search->IsReached(to)) {
+            result.push_back(ExtractRoute(*search, to));
+        } else {
+            result.push_back(std::nullopt);
+        }
+    }
+    return result;
+}
+
+template <typename Weight>
+std::vector<std::pair<VertexId, Weight>> DijkstraRouter<Weight>::BuildReachable(VertexId from,
+                                                                                Weight max_weight) const {
+    CheckVertex(from);
+    std::vector<std::pair<VertexId, Weight>> result;
+    if (max_weight < ZERO_WEIGHT) {
+        return result;
+    }
+    const auto search = search_spaces_.Acquire();
+    search->Start();
+    search->Reach(from, ZERO_WEIGHT, std::nullopt);
+    while (!search->queue.empty()) {
+        std::pop_heap(search->queue.begin(), search->queue.end(), std::greater<QueueItem>{});
+        const auto [weight, vertex] = search->queue.back();
+        search->queue.pop_back();
+        if (search->weights[vertex] < weight) {
+            continue;
+        }
+        result.emplace_back(vertex, weight);
+        for (const auto& edge : graph_.GetOutgoingEdges(vertex)) {
+            const Weight candidate_weight = weight + edge.weight;
+            // Вершины за пределами бюджета в очередь не попадают, поэтому она иссякает сразу за его границей
+            if (!(max_weight < candidate_weight)
+                && (!search->IsReached(edge.to) || candidate_weight < search->weights[edge.to])) {
+                search->Reach(edge.to, candidate_weight, edge.id);
+            }
+        }
+    }
+    return result;
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::RouteInfo DijkstraRouter<Weight>::ExtractRoute(const SearchSpace& search,
+                                                                                VertexId to) const {
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = search.prev_edges[to];
+         edge_id;
+         edge_id = search.prev_edges[graph_.GetEdge(*edge_id).from])
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{search.weights[to], std::move(edges)};
+}
+
+}  // namespace graph
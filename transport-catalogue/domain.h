@@ -21,12 +21,28 @@ namespace data {
 struct Stop {
     std::string name;
     geo::Coordinates coordinates;
+    // Порядковый номер остановки в справочнике: от 0 до GetStopsCount() - 1
+    size_t index;
 };
 
 struct Bus {
     std::string name;
     std::vector<const Stop *> route;
     bool is_roundtrip;
+    // Порядковый номер автобуса в справочнике
+    size_t index;
+};
+
+// Характеристики маршрута автобуса для запроса Bus
+struct BusStats {
+    size_t stop_count;
+    size_t unique_stop_count;
+    // Длина по дорогам в метрах
+    int route_length;
+    // Длина по прямой между соседними остановками в метрах
+    double geo_length;
+    // Отношение длины по дорогам к длине по прямой
+    double curvature;
 };
 
 struct StopsHasher {
@@ -60,9 +76,37 @@ struct RenderSettings {
     std::vector<svg::Color> color_palette;
 };
 
+enum class RouterEngineType {
+    ALL_PAIRS,
+    DIJKSTRA,
+    CONTRACTION_HIERARCHIES,
+    A_STAR,
+    ALT,
+    RAPTOR,
+    HUB_LABELS,
+    CUSTOMIZABLE_ROUTE_PLANNING
+};
+
+enum class RouterGraphModel {
+    STOP_PAIRS,
+    BUS_LINES
+};
+
 struct RoutingSettings {
     int bus_wait_time = 0;
     double bus_velocity = 0;
+    RouterEngineType router_engine = RouterEngineType::ALL_PAIRS;
+    RouterGraphModel graph_model = RouterGraphModel::STOP_PAIRS;
+    size_t router_thread_count = 1;
+    size_t landmark_count = 8;
+    size_t route_cache_size = 0;
+    // Число целых единиц веса в минуте, 0 - веса с плавающей точкой
+    size_t weight_units_per_minute = 0;
+    // Файл меток движка HUB_LABELS: если они построены по этому же графу, загружаются из него,
+    // иначе строятся заново и записываются в него. Пусто - метки всегда строятся
+    std::string hub_labels_path;
+    // Перенумерация вершин графа вдоль кривой Гильберта; выключается только для сравнения в бенчмарке
+    bool reorder_vertexes = true;
 };
 
 
@@ -72,6 +116,10 @@ struct StatRequest {
     std::string name;
     std::string from;
     std::string to;
+    std::vector<std::string> origins;
+    std::vector<std::string> destinations;
+    double max_time = 0;
+    bool with_convex_hull = false;
 };
 
 struct Route {
@@ -87,4 +135,10 @@ struct StatRouteInfo {
     std::vector<Route> route;
 };
 
+// Остановка, до которой можно добраться за время weight
+struct ReachableStop {
+    const data::Stop* stop;
+    double weight;
+};
+
 } // namespace request
\ No newline at end of file
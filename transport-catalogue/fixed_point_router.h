@@ -0,0 +1,186 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Движок на целочисленных весах за интерфейсом RouterEngine<double>. Веса графа переводятся
+// в целые единицы (вес * units_per_weight с округлением) в собственную замороженную копию графа
+// с теми же EdgeId, ответы движка переводятся обратно делением на units_per_weight.
+// Сумма целых не зависит от порядка сложения, а целые веса меньше и быстрее складываются.
+// Кратчайший маршрут проходит каждую вершину не больше раза, поэтому его вес не больше суммы
+// наибольших весов исходящих рёбер по всем вершинам. Эта сумма должна быть меньше половины
+// диапазона FixedWeight, тогда сложение весов любых двух маршрутов не переполняется
+template <typename FixedWeight>
+class FixedPointRouter final : public RouterEngine<double> {
+    static_assert(std::is_integral_v<FixedWeight> && std::is_unsigned_v<FixedWeight>,
+                  "Fixed-point weights should be unsigned integers");
+
+public:
+    using FixedGraph = DirectedWeightedGraph<FixedWeight>;
+    using EngineFactory = std::function<std::unique_ptr<RouterEngine<FixedWeight>>(const FixedGraph& graph)>;
+
+    // Движок строится фабрикой по целочисленному графу, она же строит его заново,
+    // если движок не умеет подстраиваться под новые веса
+    FixedPointRouter(const DirectedWeightedGraph<double>& graph, double units_per_weight, EngineFactory factory);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override;
+
+    std::vector<std::optional<double>> BuildWeightsMatrix(const std::vector<VertexId>& sources,
+                                                          const std::vector<VertexId>& targets) const override;
+
+    // Изменённые веса заново переводятся в целые и передаются движку
+    bool UpdateEdgeWeights(const std::vector<EdgeWeightChange<double>>& changes) override;
+
+    // Вес ребра, с которым считает движок, в исходных единицах
+    double GetEdgeWeight(EdgeId edge_id) const {
+        return ToWeight(fixed_graph_.GetEdge(edge_id).weight);
+    }
+
+    const FixedGraph& GetFixedGraph() const {
+        return fixed_graph_;
+    }
+
+private:
+    // Половина диапазона - это и INFINITE_WEIGHT движков, поэтому веса маршрутов должны быть строго меньше
+    static constexpr std::uint64_t MAX_ROUTE_WEIGHT = std::numeric_limits<FixedWeight>::max() / 2;
+
+    FixedWeight ToFixed(double weight) const;
+
+    double ToWeight(FixedWeight weight) const {
+        return weight / units_per_weight_;
+    }
+
+    std::optional<RouteInfo> ToRouteInfo(std::optional<typename RouterEngine<FixedWeight>::RouteInfo> route) const;
+
+    void CheckRouteWeightBound() const;
+
+    const DirectedWeightedGraph<double>& graph_;
+    const double units_per_weight_;
+    EngineFactory factory_;
+    FixedGraph fixed_graph_;
+    std::unique_ptr<RouterEngine<FixedWeight>> engine_;
+};
+
+template <typename FixedWeight>
+FixedPointRouter<FixedWeight>::FixedPointRouter(const DirectedWeightedGraph<double>& graph, double units_per_weight,
+                                                EngineFactory factory)
+    : graph_(graph)
+    , units_per_weight_(units_per_weight)
+    , factory_(std::move(factory))
+    , fixed_graph_(graph.GetVertexCount())
+{
+    if (!(units_per_weight > 0)) {
+        throw std::invalid_argument("Units per weight should be positive");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        fixed_graph_.AddEdge({edge.from, edge.to, ToFixed(edge.weight)});
+    }
+    fixed_graph_.Freeze();
+    CheckRouteWeightBound();
+    engine_ = factory_(fixed_graph_);
+}
+
+template <typename FixedWeight>
+std::optional<typename FixedPointRouter<FixedWeight>::RouteInfo> FixedPointRouter<FixedWeight>::BuildRoute(
+    VertexId from, VertexId to) const {
+    return ToRouteInfo(engine_->BuildRoute(from, to));
+}
+
+template <typename FixedWeight>
+std::vector<std::optional<typename FixedPointRouter<FixedWeight>::RouteInfo>>
+FixedPointRouter<FixedWeight>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+    std::vector<std::optional<RouteInfo>> result;
+    result.reserve(targets.size());
+    for (auto& route : engine_->BuildRoutes(from, targets)) {
+        result.push_back(ToRouteInfo(std::move(route)));
+    }
+    return result;
+}
+
+template <typename FixedWeight>
+std::vector<std::optional<double>> FixedPointRouter<FixedWeight>::BuildWeightsMatrix(
+    const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+    std::vector<std::optional<double>> result;
+    result.reserve(sources.size() * targets.size());
+    for (const auto& weight : engine_->BuildWeightsMatrix(sources, targets)) {
+        result.push_back(weight ? std::optional<double>(ToWeight(*weight)) : std::nullopt);
+    }
+    return result;
+}
+
+template <typename FixedWeight>
+bool FixedPointRouter<FixedWeight>::UpdateEdgeWeights(const std::vector<EdgeWeightChange<double>>& changes) {
+    std::vector<EdgeWeightChange<FixedWeight>> fixed_changes;
+    for (const auto& change : changes) {
+        const FixedWeight old_weight = fixed_graph_.GetEdge(change.edge_id).weight;
+        const FixedWeight weight = ToFixed(graph_.GetEdge(change.edge_id).weight);
+        // Изменение меньше половины единицы может не изменить целый вес
+        if (weight != old_weight) {
+            fixed_graph_.SetEdgeWeight(change.edge_id, weight);
+            fixed_changes.push_back(EdgeWeightChange<FixedWeight>{change.edge_id, old_weight});
+        }
+    }
+    if (fixed_changes.empty()) {
+        return true;
+    }
+    CheckRouteWeightBound();
+    if (!engine_->UpdateEdgeWeights(fixed_changes)) {
+        engine_ = factory_(fixed_graph_);
+    }
+    return true;
+}
+
+template <typename FixedWeight>
+FixedWeight FixedPointRouter<FixedWeight>::ToFixed(double weight) const {
+    const double units = std::round(weight * units_per_weight_);
+    if (!(units >= 0)) {
+        throw std::domain_error("Edges' weights should be non-negative");
+    }
+    if (!(units < static_cast<double>(MAX_ROUTE_WEIGHT))) {
+        throw std::overflow_error("Edge weight is too large for fixed-point weights");
+    }
+    return static_cast<FixedWeight>(units);
+}
+
+template <typename FixedWeight>
+std::optional<typename FixedPointRouter<FixedWeight>::RouteInfo> FixedPointRouter<FixedWeight>::ToRouteInfo(
+    std::optional<typename RouterEngine<FixedWeight>::RouteInfo> route) const {
+    if (!route) {
+        return std::nullopt;
+    }
+    return RouteInfo{ToWeight(route->weight), std::move(route->edges)};
+}
+
+template <typename FixedWeight>
+void FixedPointRouter<FixedWeight>::CheckRouteWeightBound() const {
+    std::uint64_t bound = 0;
+    for (VertexId vertex = 0; vertex < fixed_graph_.GetVertexCount(); ++vertex) {
+        FixedWeight max_weight = 0;
+        for (const auto& edge : fixed_graph_.GetOutgoingEdges(vertex)) {
+            max_weight = std::max(max_weight, edge.weight);
+        }
+        bound += max_weight;
+        if (bound >= MAX_ROUTE_WEIGHT) {
+            throw std::overflow_error("Routes may be too long for fixed-point weights");
+        }
+    }
+}
+
+}  // namespace graph
@@ -1,7 +1,9 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
+#include <utility>
 
 namespace geo {
 
@@ -14,4 +16,64 @@ double ComputeDistance(Coordinates from, Coordinates to) {
            * earth_radius;
 }
 
+std::vector<Coordinates> ComputeConvexHull(std::vector<Coordinates> points) {
+    // Алгоритм Эндрю: нижняя и верхняя цепочки по точкам, упорядоченным по долготе
+    const auto is_less = [](Coordinates lhs, Coordinates rhs) {
+        return lhs.lng < rhs.lng || (lhs.lng == rhs.lng && lhs.lat < rhs.lat);
+    };
+    std::sort(points.begin(), points.end(), is_less);
+    points.erase(std::unique(points.begin(), points.end(), [](Coordinates lhs, Coordinates rhs) {
+        return lhs.lng == rhs.lng && lhs.lat == rhs.lat;
+    }), points.end());
+    if (points.size() < 3) {
+        return points;
+    }
+    // Положительно, если поворот o -> a -> b против часовой стрелки
+    const auto cross = [](Coordinates o, Coordinates a, Coordinates b) {
+        return (a.lng - o.lng) * (b.lat - o.lat) - (a.lat - o.lat) * (b.lng - o.lng);
+    };
+    std::vector<Coordinates> hull(2 * points.size());
+    size_t size = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        while (size >= 2 && cross(hull[size - 2], hull[size - 1], points[i]) <= 0) {
+            --size;
+        }
+        hull[size++] = points[i];
+    }
+    for (size_t i = points.size() - 1, lower_size = size + 1; i > 0; --i) {
+        while (size >= lower_size && cross(hull[size - 2], hull[size - 1], points[i - 1]) <= 0) {
+            --size;
+        }
+        hull[size++] = points[i - 1];
+    }
+    // Последняя точка совпадает с первой
+    hull.resize(size - 1);
+    return hull;
+}
+
+std::uint64_t ComputeHilbertIndex(Coordinates point) {
+    constexpr std::uint64_t grid_size = std::uint64_t{1} << 32;
+    const auto to_grid = [](double value, double min_value, double max_value) {
+        const double position = (value - min_value) / (max_value - min_value) * static_cast<double>(grid_size);
+        return static_cast<std::uint64_t>(std::clamp(position, 0.0, static_cast<double>(grid_size - 1)));
+    };
+    std::uint64_t x = to_grid(point.lng, -180, 180);
+    std::uint64_t y = to_grid(point.lat, -90, 90);
+    std::uint64_t index = 0;
+    for (std::uint64_t size = grid_size / 2; size > 0; size /= 2) {
+        const std::uint64_t rx = (x & size) > 0;
+        const std::uint64_t ry = (y & size) > 0;
+        index += size * size * ((3 * rx) ^ ry);
+        // Четверть поворачивается так, чтобы кривая внутри неё шла в том же направлении, что и во всей решётке
+        if (ry == 0) {
+            if (rx == 1) {
+                x = grid_size - 1 - x;
+                y = grid_size - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
 }  // namespace geo
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 namespace geo {
 
 struct Coordinates {
@@ -9,5 +12,13 @@ struct Coordinates {
 
 double ComputeDistance(Coordinates from, Coordinates to);
 
+// Выпуклая оболочка точек на плоскости (долгота, широта) против часовой стрелки, без повторов.
+// Для вырожденных наборов возвращает одну или две крайние точки
+std::vector<Coordinates> ComputeConvexHull(std::vector<Coordinates> points);
+
+// Номер точки на кривой Гильберта, проведённой через решётку 2^32 x 2^32 по всей поверхности.
+// Близкие точки обычно получают близкие номера
+std::uint64_t ComputeHilbertIndex(Coordinates point);
+
 
 }  // namespace geo
\ No newline at end of file
@@ -2,7 +2,10 @@
 
 #include "ranges.h"
 
+#include <cstddef>
 #include <cstdlib>
+#include <iterator>
+#include <stdexcept>
 #include <vector>
 
 namespace graph {
@@ -17,43 +20,154 @@ struct Edge {
     Weight weight;
 };
 
+// Исходящее ребро в замороженном графе: всё, что нужно для релаксации, без обращения к GetEdge
+template <typename Weight>
+struct OutgoingEdge {
+    EdgeId id;
+    VertexId to;
+    Weight weight;
+};
+
+// Граф наполняется через AddEdge, после чего его можно заморозить вызовом Freeze.
+// Замороженный граф хранит исходящие рёбра в формате CSR (compressed sparse row):
+// рёбра вершины v лежат подряд на позициях [offsets_[v], offsets_[v + 1]) массивов
+// edge_ids_, targets_ и weights_, поэтому поиск перебирает их без лишних косвенных обращений.
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
     using IncidenceList = std::vector<EdgeId>;
-    using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using IncidentEdgesRange = ranges::Range<const EdgeId*>;
 
 public:
+    class OutgoingEdgeIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = OutgoingEdge<Weight>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        OutgoingEdgeIterator(const DirectedWeightedGraph* graph, size_t index)
+            : edge_ids_(graph->edge_ids_.data())
+            , targets_(graph->targets_.data())
+            , weights_(graph->weights_.data())
+            , index_(index) {
+        }
+
+        value_type operator*() const {
+            return {edge_ids_[index_], targets_[index_], weights_[index_]};
+        }
+        OutgoingEdgeIterator& operator++() {
+            ++index_;
+            return *this;
+        }
+        bool operator==(const OutgoingEdgeIterator& other) const {
+            return index_ == other.index_;
+        }
+        bool operator!=(const OutgoingEdgeIterator& other) const {
+            return index_ != other.index_;
+        }
+
+    private:
+        const EdgeId* edge_ids_;
+        const VertexId* targets_;
+        const Weight* weights_;
+        size_t index_;
+    };
+
+    using OutgoingEdgesRange = ranges::Range<OutgoingEdgeIterator>;
+
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    // Меняет вес существующего ребра, в том числе в замороженном графе
+    void SetEdgeWeight(EdgeId edge_id, Weight weight);
+
+    // Строит CSR-представление. После этого добавлять рёбра нельзя
+    void Freeze();
+    bool IsFrozen() const;
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    // Доступно только для замороженного графа
+    OutgoingEdgesRange GetOutgoingEdges(VertexId vertex) const;
 
 private:
+    size_t vertex_count_ = 0;
+    bool is_frozen_ = false;
     std::vector<Edge<Weight>> edges_;
     std::vector<IncidenceList> incidence_lists_;
+
+    std::vector<size_t> offsets_;
+    // Позиция ребра в массивах CSR по его EdgeId
+    std::vector<size_t> edge_positions_;
+    std::vector<EdgeId> edge_ids_;
+    std::vector<VertexId> targets_;
+    std::vector<Weight> weights_;
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : vertex_count_(vertex_count)
+    , incidence_lists_(vertex_count) {
 }
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (is_frozen_) {
+        throw std::logic_error("Can't add an edge to a frozen graph");
+    }
     edges_.push_back(edge);
     const EdgeId id = edges_.size() - 1;
     incidence_lists_.at(edge.from).push_back(id);
     return id;
 }
 
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::SetEdgeWeight(EdgeId edge_id, Weight weight) {
+    edges_.at(edge_id).weight = weight;
+    if (is_frozen_) {
+        weights_[edge_positions_[edge_id]] = weight;
+    }
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Freeze() {
+    if (is_frozen_) {
+        return;
+    }
+    offsets_.assign(vertex_count_ + 1, 0);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        offsets_[vertex + 1] = offsets_[vertex] + incidence_lists_[vertex].size();
+    }
+    edge_positions_.resize(edges_.size());
+    edge_ids_.reserve(edges_.size());
+    targets_.reserve(edges_.size());
+    weights_.reserve(edges_.size());
+    // Порядок рёбер вершины сохраняется, чтобы поиск перебирал их так же, как до заморозки
+    for (const IncidenceList& incidence_list : incidence_lists_) {
+        for (const EdgeId edge_id : incidence_list) {
+            edge_positions_[edge_id] = edge_ids_.size();
+            edge_ids_.push_back(edge_id);
+            targets_.push_back(edges_[edge_id].to);
+            weights_.push_back(edges_[edge_id].weight);
+        }
+    }
+    incidence_lists_.clear();
+    incidence_lists_.shrink_to_fit();
+    is_frozen_ = true;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+    return is_frozen_;
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return vertex_count_;
 }
 
 template <typename Weight>
@@ -69,6 +183,20 @@ const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-    return ranges::AsRange(incidence_lists_.at(vertex));
+    if (is_frozen_) {
+        const EdgeId* edge_ids = edge_ids_.data();
+        return {edge_ids + offsets_.at(vertex), edge_ids + offsets_.at(vertex + 1)};
+    }
+    const IncidenceList& incidence_list = incidence_lists_.at(vertex);
+    return {incidence_list.data(), incidence_list.data() + incidence_list.size()};
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::OutgoingEdgesRange
+DirectedWeightedGraph<Weight>::GetOutgoingEdges(VertexId vertex) const {
+    if (!is_frozen_) {
+        throw std::logic_error("Graph should be frozen");
+    }
+    return {OutgoingEdgeIterator(this, offsets_.at(vertex)), OutgoingEdgeIterator(this, offsets_.at(vertex + 1))};
 }
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,486 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Разметка хабами (hub labeling). У каждой вершины v есть исходящая метка - пары (хаб h, d(v, h)) -
+// и входящая - пары (h, d(h, v)), причём любой кратчайший путь s -> t проходит через хаб,
+// общий для out(s) и in(t). Вес маршрута - минимум d(s, h) + d(h, t) по общим хабам,
+// то есть слияние двух коротких отсортированных массивов без поиска по графу.
+// Метки строятся обрезанными поисками Дейкстры (pruned landmark labeling) из вершин по убыванию
+// степени: поиск из хаба не идёт дальше вершин, путь до которых уже покрыт более важными хабами.
+// Все метки хранятся в плоских массивах, поэтому их можно сохранить в поток и быстро загрузить.
+// Вес считается без восстановления пути (GetWeight, BuildWeightsMatrix), BuildRoute дополнительно
+// раскрывает путь по рёбрам, записанным в метках.
+// Граф должен быть заморожен. Запросы можно выполнять из нескольких потоков одновременно.
+template <typename Weight>
+class HubLabelsRouter final : public RouterEngine<Weight> {
+    static_assert(std::is_trivially_copyable_v<Weight>, "Labels are serialized as raw bytes");
+
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+
+    explicit HubLabelsRouter(const Graph& graph);
+
+    // Метки, сохранённые SaveLabels для этого же графа. Если данные повреждены или построены
+    // по другому графу, бросает std::runtime_error
+    HubLabelsRouter(const Graph& graph, std::istream& input);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Вес маршрута без восстановления пути
+    std::optional<Weight> GetWeight(VertexId from, VertexId to) const;
+
+    std::vector<std::optional<Weight>> BuildWeightsMatrix(const std::vector<VertexId>& sources,
+                                                          const std::vector<VertexId>& targets) const override;
+
+    // Двоичный формат с порядком байтов текущей платформы
+    void SaveLabels(std::ostream& output) const;
+
+    // Суммарное число записей во всех метках
+    size_t GetLabelEntryCount() const {
+        return out_labels_.hubs.size() + in_labels_.hubs.size();
+    }
+
+private:
+    using CompactId = std::uint32_t;
+
+    static constexpr CompactId NO_EDGE = std::numeric_limits<CompactId>::max();
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+                                              ? std::numeric_limits<Weight>::infinity()
+                                              : std::numeric_limits<Weight>::max() / 2;
+    static constexpr char FORMAT_TAG[8] = {'H', 'U', 'B', 'L', 'B', 'L', '0', '1'};
+
+    // Метки всех вершин одного направления: записи вершины v - [offsets[v], offsets[v + 1]),
+    // упорядоченные по номеру хаба в порядке важности
+    struct Labels {
+        std::vector<std::uint64_t> offsets;
+        std::vector<CompactId> hubs;
+        std::vector<Weight> weights;
+        // Ребро пути между вершиной и хабом, ближайшее к вершине; NO_EDGE у записи самого хаба
+        std::vector<CompactId> edges;
+    };
+
+    // Общий хаб маршрута и позиции его записей в метках out(from) и in(to)
+    struct Meeting {
+        Weight weight;
+        size_t out_index;
+        size_t in_index;
+    };
+
+    struct LabelEntry {
+        CompactId hub;
+        Weight weight;
+        CompactId edge;
+    };
+
+    void CheckVertex(VertexId vertex) const {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of graph");
+        }
+    }
+
+    std::optional<Meeting> FindMeeting(VertexId from, VertexId to) const;
+
+    void BuildLabels();
+
+    // Обрезанный поиск из хаба с номером hub_rank: вперёд заполняет входящие метки, назад - исходящие
+    void AddLabelsFromHub(VertexId hub, CompactId hub_rank, bool is_backward,
+                          std::vector<std::vector<LabelEntry>>& labels,
+                          const std::vector<std::vector<LabelEntry>>& opposite_labels,
+                          std::vector<Weight>& hub_weights, std::vector<Weight>& weights,
+                          std::vector<std::optional<EdgeId>>& prev_edges,
+                          const std::vector<std::vector<EdgeId>>& incoming_edges) const;
+
+    static Labels Flatten(std::vector<std::vector<LabelEntry>>&& labels);
+
+    // Индекс записи хаба hub в метке вершины vertex
+    static size_t FindEntry(const Labels& labels, VertexId vertex, CompactId hub);
+
+    std::uint64_t ComputeGraphFingerprint() const;
+
+    static void WriteLabels(std::ostream& output, const Labels& labels);
+    static Labels ReadLabels(std::istream& input, size_t vertex_count, size_t edge_count);
+
+    const Graph& graph_;
+    Labels out_labels_;
+    Labels in_labels_;
+};
+
+template <typename Weight>
+HubLabelsRouter<Weight>::HubLabelsRouter(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    if (graph.GetEdgeCount() >= NO_EDGE || graph.GetVertexCount() >= NO_EDGE) {
+        throw std::length_error("Graph is too large for hub labels");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    BuildLabels();
+}
+
+namespace detail {
+
+template <typename T>
+void WriteRaw(std::ostream& output, const T& value) {
+    output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T ReadRaw(std::istream& input) {
+    T value{};
+    if (!input.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        throw std::runtime_error("Unexpected end of hub labels");
+    }
+    return value;
+}
+
+}  // namespace detail
+
+template <typename Weight>
+HubLabelsRouter<Weight>::HubLabelsRouter(const Graph& graph, std::istream& input)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    char tag[sizeof(FORMAT_TAG)];
+    if (!input.read(tag, sizeof(tag)) || !std::equal(std::begin(tag), std::end(tag), std::begin(FORMAT_TAG))) {
+        throw std::runtime_error("Not a hub labels stream");
+    }
+    if (detail::ReadRaw<std::uint64_t>(input) != sizeof(Weight)
+        || detail::ReadRaw<std::uint64_t>(input) != graph.GetVertexCount()
+        || detail::ReadRaw<std::uint64_t>(input) != graph.GetEdgeCount()
+        || detail::ReadRaw<std::uint64_t>(input) != ComputeGraphFingerprint()) {
+        throw std::runtime_error("Hub labels were built for another graph");
+    }
+    out_labels_ = ReadLabels(input, graph.GetVertexCount(), graph.GetEdgeCount());
+    in_labels_ = ReadLabels(input, graph.GetVertexCount(), graph.GetEdgeCount());
+}
+
+template <typename Weight>
+void HubLabelsRouter<Weight>::SaveLabels(std::ostream& output) const {
+    output.write(FORMAT_TAG, sizeof(FORMAT_TAG));
+    detail::WriteRaw<std::uint64_t>(output, sizeof(Weight));
+    detail::WriteRaw<std::uint64_t>(output, graph_.GetVertexCount());
+    detail::WriteRaw<std::uint64_t>(output, graph_.GetEdgeCount());
+    detail::WriteRaw<std::uint64_t>(output, ComputeGraphFingerprint());
+    WriteLabels(output, out_labels_);
+    WriteLabels(output, in_labels_);
+}
+
+template <typename Weight>
+void HubLabelsRouter<Weight>::WriteLabels(std::ostream& output, const Labels& labels) {
+    const auto write_array = [&output](const auto& values) {
+        detail::WriteRaw<std::uint64_t>(output, values.size());
+        output.write(reinterpret_cast<const char*>(values.data()),
+                     static_cast<std::streamsize>(values.size() * sizeof(values[0])));
+    };
+    write_array(labels.offsets);
+    write_array(labels.hubs);
+    write_array(labels.weights);
+    write_array(labels.edges);
+}
+
+template <typename Weight>
+typename HubLabelsRouter<Weight>::Labels HubLabelsRouter<Weight>::ReadLabels(std::istream& input,
+                                                                             size_t vertex_count,
+                                                                             size_t edge_count) {
+    // Размеру массива из файла нельзя верить заранее: память растёт частями по мере того,
+    // как из потока действительно читаются данные
+    static constexpr std::uint64_t CHUNK_SIZE = 1 << 16;
+    const auto read_array = [&input](auto& values) {
+        const auto size = detail::ReadRaw<std::uint64_t>(input);
+        values.clear();
+        while (values.size() < size) {
+            const size_t begin = values.size();
+            values.resize(begin + std::min(size - begin, CHUNK_SIZE));
+            if (!input.read(reinterpret_cast<char*>(values.data() + begin),
+                            static_cast<std::streamsize>((values.size() - begin) * sizeof(values[0])))) {
+                throw std::runtime_error("Unexpected end of hub labels");
+            }
+        }
+    };
+    Labels labels;
+    read_array(labels.offsets);
+    read_array(labels.hubs);
+    read_array(labels.weights);
+    read_array(labels.edges);
+    const size_t entry_count = labels.hubs.size();
+    if (labels.offsets.size() != vertex_count + 1 || labels.offsets.front() != 0
+        || labels.offsets.back() != entry_count || !std::is_sorted(labels.offsets.begin(), labels.offsets.end())
+        || labels.weights.size() != entry_count || labels.edges.size() != entry_count) {
+        throw std::runtime_error("Corrupted hub labels");
+    }
+    // Номера хабов и рёбер потом используются как индексы без проверок, а FindEntry
+    // ищет хаб двоичным поиском, поэтому внутри метки вершины хабы должны строго возрастать
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (size_t index = labels.offsets[vertex]; index < labels.offsets[vertex + 1]; ++index) {
+            if (labels.hubs[index] >= vertex_count
+                || (index > labels.offsets[vertex] && labels.hubs[index - 1] >= labels.hubs[index])
+                || (labels.edges[index] != NO_EDGE && labels.edges[index] >= edge_count)) {
+                throw std::runtime_error("Corrupted hub labels");
+            }
+        }
+    }
+    return labels;
+}
+
+template <typename Weight>
+std::uint64_t HubLabelsRouter<Weight>::ComputeGraphFingerprint() const {
+    // FNV-1a по концам и байтам весов всех рёбер
+    std::uint64_t hash = 14695981039346656037ULL;
+    const auto add_bytes = [&hash](const void* data, size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        const std::uint64_t ends[] = {edge.from, edge.to};
+        add_bytes(ends, sizeof(ends));
+        add_bytes(&edge.weight, sizeof(edge.weight));
+    }
+    return hash;
+}
+
+template <typename Weight>
+void HubLabelsRouter<Weight>::BuildLabels() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    // Через вершины с большим числом рёбер проходит больше кратчайших путей, они становятся хабами первыми
+    std::vector<size_t> degrees(vertex_count, 0);
+    std::vector<std::vector<EdgeId>> incoming_edges(vertex_count);
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        ++degrees[edge.from];
+        ++degrees[edge.to];
+        incoming_edges[edge.to].push_back(edge_id);
+    }
+    std::vector<VertexId> order(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order[vertex] = vertex;
+    }
+    std::stable_sort(order.begin(), order.end(), [&degrees](VertexId lhs, VertexId rhs) {
+        return degrees[lhs] > degrees[rhs];
+    });
+
+    std::vector<std::vector<LabelEntry>> out_labels(vertex_count);
+    std::vector<std::vector<LabelEntry>> in_labels(vertex_count);
+    std::vector<Weight> hub_weights(vertex_count, INFINITE_WEIGHT);
+    std::vector<Weight> weights(vertex_count, INFINITE_WEIGHT);
+    std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+    for (CompactId rank = 0; rank < vertex_count; ++rank) {
+        AddLabelsFromHub(order[rank], rank, false, in_labels, out_labels, hub_weights, weights, prev_edges,
+                         incoming_edges);
+        AddLabelsFromHub(order[rank], rank, true, out_labels, in_labels, hub_weights, weights, prev_edges,
+                         incoming_edges);
+    }
+    out_labels_ = Flatten(std::move(out_labels));
+    in_labels_ = Flatten(std::move(in_labels));
+}
+
+template <typename Weight>
+void HubLabelsRouter<Weight>::AddLabelsFromHub(VertexId hub, CompactId hub_rank, bool is_backward,
+                                               std::vector<std::vector<LabelEntry>>& labels,
+                                               const std::vector<std::vector<LabelEntry>>& opposite_labels,
+                                               std::vector<Weight>& hub_weights, std::vector<Weight>& weights,
+                                               std::vector<std::optional<EdgeId>>& prev_edges,
+                                               const std::vector<std::vector<EdgeId>>& incoming_edges) const {
+    // Веса хаба до более важных хабов раскладываются по их номерам, чтобы проверка покрытия
+    // вершины стоила одного прохода по её метке
+    for (const LabelEntry& entry : opposite_labels[hub]) {
+        hub_weights[entry.hub] = entry.weight;
+    }
+    const auto covered_weight = [&](VertexId vertex) {
+        Weight result = INFINITE_WEIGHT;
+        for (const LabelEntry& entry : labels[vertex]) {
+            result = std::min(result, hub_weights[entry.hub] + entry.weight);
+        }
+        return result;
+    };
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::vector<QueueItem> queue;
+    std::vector<VertexId> reached{hub};
+    weights[hub] = Weight{};
+    prev_edges[hub] = std::nullopt;
+    queue.emplace_back(Weight{}, hub);
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        const auto [weight, vertex] = queue.back();
+        queue.pop_back();
+        if (weights[vertex] < weight) {
+            continue;
+        }
+        // Путь уже покрыт более важным хабом: ни вершина, ни пути через неё новой записи не требуют
+        if (!(weight < covered_weight(vertex))) {
+            continue;
+        }
+        labels[vertex].push_back(
+            LabelEntry{hub_rank, weight, prev_edges[vertex] ? static_cast<CompactId>(*prev_edges[vertex]) : NO_EDGE});
+        const auto relax = [&](VertexId next_vertex, EdgeId edge_id, Weight edge_weight) {
+            const Weight candidate_weight = weight + edge_weight;
+            if (candidate_weight < weights[next_vertex]) {
+                if (!(weights[next_vertex] < INFINITE_WEIGHT)) {
+                    reached.push_back(next_vertex);
+                }
+                weights[next_vertex] = candidate_weight;
+                prev_edges[next_vertex] = edge_id;
+                queue.emplace_back(candidate_weight, next_vertex);
+                std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+            }
+        };
+        if (is_backward) {
+            // Поиск назад идёт по входящим рёбрам, у них запоминается ребро к вершине ближе к хабу
+            for (const EdgeId edge_id : incoming_edges[vertex]) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                relax(edge.from, edge_id, edge.weight);
+            }
+        } else {
+            for (const auto& edge : graph_.GetOutgoingEdges(vertex)) {
+                relax(edge.to, edge.id, edge.weight);
+            }
+        }
+    }
+
+    for (const VertexId vertex : reached) {
+        weights[vertex] = INFINITE_WEIGHT;
+    }
+    for (const LabelEntry& entry : opposite_labels[hub]) {
+        hub_weights[entry.hub] = INFINITE_WEIGHT;
+    }
+}
+
+template <typename Weight>
+typename HubLabelsRouter<Weight>::Labels HubLabelsRouter<Weight>::Flatten(
+    std::vector<std::vector<LabelEntry>>&& labels) {
+    Labels result;
+    result.offsets.reserve(labels.size() + 1);
+    result.offsets.push_back(0);
+    for (const auto& label : labels) {
+        result.offsets.push_back(result.offsets.back() + label.size());
+    }
+    result.hubs.reserve(result.offsets.back());
+    result.weights.reserve(result.offsets.back());
+    result.edges.reserve(result.offsets.back());
+    for (auto& label : labels) {
+        for (const LabelEntry& entry : label) {
+            result.hubs.push_back(entry.hub);
+            result.weights.push_back(entry.weight);
+            result.edges.push_back(entry.edge);
+        }
+        label.clear();
+        label.shrink_to_fit();
+    }
+    return result;
+}
+
+template <typename Weight>
+std::optional<typename HubLabelsRouter<Weight>::Meeting> HubLabelsRouter<Weight>::FindMeeting(VertexId from,
+                                                                                             VertexId to) const {
+    CheckVertex(from);
+    CheckVertex(to);
+    std::optional<Meeting> result;
+    size_t out_index = out_labels_.offsets[from];
+    const size_t out_end = out_labels_.offsets[from + 1];
+    size_t in_index = in_labels_.offsets[to];
+    const size_t in_end = in_labels_.offsets[to + 1];
+    while (out_index < out_end && in_index < in_end) {
+        const CompactId out_hub = out_labels_.hubs[out_index];
+        const CompactId in_hub = in_labels_.hubs[in_index];
+        if (out_hub < in_hub) {
+            ++out_index;
+        } else if (in_hub < out_hub) {
+            ++in_index;
+        } else {
+            const Weight weight = out_labels_.weights[out_index] + in_labels_.weights[in_index];
+            if (!result || weight < result->weight) {
+                result = Meeting{weight, out_index, in_index};
+            }
+            ++out_index;
+            ++in_index;
+        }
+    }
+    return result;
+}
+
+template <typename Weight>
+std::optional<Weight> HubLabelsRouter<Weight>::GetWeight(VertexId from, VertexId to) const {
+    const auto meeting = FindMeeting(from, to);
+    return meeting ? std::optional<Weight>(meeting->weight) : std::nullopt;
+}
+
+template <typename Weight>
+size_t HubLabelsRouter<Weight>::FindEntry(const Labels& labels, VertexId vertex, CompactId hub) {
+    const auto begin = labels.hubs.begin() + labels.offsets[vertex];
+    const auto end = labels.hubs.begin() + labels.offsets[vertex + 1];
+    const auto it = std::lower_bound(begin, end, hub);
+    if (it == end || *it != hub) {
+        throw std::logic_error("Hub labels are inconsistent");
+    }
+    return it - labels.hubs.begin();
+}
+
+template <typename Weight>
+std::optional<typename HubLabelsRouter<Weight>::RouteInfo> HubLabelsRouter<Weight>::BuildRoute(VertexId from,
+                                                                                               VertexId to) const {
+    const auto meeting = FindMeeting(from, to);
+    if (!meeting) {
+        return std::nullopt;
+    }
+    const CompactId hub = out_labels_.hubs[meeting->out_index];
+    // Поиск, построивший запись метки, прошёл через предыдущую вершину пути без обрезки,
+    // поэтому у неё тоже есть запись этого хаба
+    std::vector<EdgeId> edges;
+    for (size_t index = meeting->out_index; out_labels_.edges[index] != NO_EDGE;) {
+        const auto& edge = graph_.GetEdge(out_labels_.edges[index]);
+        edges.push_back(out_labels_.edges[index]);
+        index = FindEntry(out_labels_, edge.to, hub);
+    }
+    const size_t out_edge_count = edges.size();
+    for (size_t index = meeting->in_index; in_labels_.edges[index] != NO_EDGE;) {
+        const auto& edge = graph_.GetEdge(in_labels_.edges[index]);
+        edges.push_back(in_labels_.edges[index]);
+        index = FindEntry(in_labels_, edge.from, hub);
+    }
+    std::reverse(edges.begin() + out_edge_count, edges.end());
+    return RouteInfo{meeting->weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> HubLabelsRouter<Weight>::BuildWeightsMatrix(
+    const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+    std::vector<std::optional<Weight>> result;
+    result.reserve(sources.size() * targets.size());
+    for (const VertexId from : sources) {
+        for (const VertexId to : targets) {
+            result.push_back(GetWeight(from, to));
+        }
+    }
+    return result;
+}
+
+}  // namespace graph
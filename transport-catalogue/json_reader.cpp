@@ -3,7 +3,10 @@
  * а также код обработки запросов к базе и формирование массива ответов в формате JSON
  */
 
+#include <algorithm>
 #include <sstream>
+#include <stdexcept>
+#include <unordered_map>
 #include "json_reader.h"
 #include "json_builder.h"
 
@@ -44,6 +47,7 @@ data::TransportCatalogue MakeCatalogueFromJSON(const json::Document &doc) {
             }
         }
     }
+    catalogue.ComputeBusesStats();
     return catalogue;
 }
 
@@ -57,17 +61,14 @@ json::Node MakeStatOfBus(const StatRequest &stat_request, const data::TransportC
                 .EndDict()
                 .Build();
     }
-    int fact_route_length = catalogue.GetFactLength(bus_ptr);
-    double curvature = fact_route_length / catalogue.GetStraightLength(bus_ptr);
-    int stop_count = static_cast<int>(catalogue.GetNumberStopsOfBus(bus_ptr));
-    int unique_stop_count = static_cast<int>(catalogue.GetNumberUniqueStopsOfBus(bus_ptr));
+    const data::BusStats bus_stats = catalogue.GetBusStats(bus_ptr);
     return json::Builder{}
             .StartDict()
-            .Key("curvature"s).Value(curvature)
+            .Key("curvature"s).Value(bus_stats.curvature)
             .Key("request_id"s).Value(stat_request.id)
-            .Key("route_length"s).Value(fact_route_length)
-            .Key("stop_count"s).Value(stop_count)
-            .Key("unique_stop_count"s).Value(unique_stop_count)
+            .Key("route_length"s).Value(bus_stats.route_length)
+            .Key("stop_count"s).Value(static_cast<int>(bus_stats.stop_count))
+            .Key("unique_stop_count"s).Value(static_cast<int>(bus_stats.unique_stop_count))
             .EndDict()
             .Build();
 }
@@ -87,12 +88,11 @@ json::Node MakeStatOfStop(const StatRequest &stat_request, const data::Transport
                 .EndDict()
                 .Build();
     }
-    const std::set<std::string_view> buses = catalogue.GetBusesByStop(stop_ptr);
     auto json_builder = json::Builder{};
     json_builder.StartDict()
         .Key("buses"s)
         .StartArray();
-    for (auto bus: buses) {
+    for (const std::string_view bus: catalogue.GetBusesByStop(stop_ptr)) {
         json_builder.Value(std::string(bus));
     }
     json_builder.EndArray()
@@ -115,8 +115,11 @@ json::Node MakeStatOfMap(const StatRequest &stat_request, render::MapRenderer &m
             .Build();
 }
 
-json::Node MakeStatOfRoute(const StatRequest &stat_request, router::TransportCatalogueRouter &router) {
-    auto route = router.BuildRoute(stat_request.from, stat_request.to);
+json::Node MakeStatOfRoute(const StatRequest &stat_request, const router::TransportCatalogueRouter &router) {
+    return MakeStatOfRoute(stat_request, router.BuildRoute(stat_request.from, stat_request.to));
+}
+
+json::Node MakeStatOfRoute(const StatRequest &stat_request, const std::optional<StatRouteInfo> &route) {
     auto json_builder = json::Builder{};
     if (!route.has_value()) {
         return json::Builder{}.StartDict()
@@ -151,15 +154,118 @@ json::Node MakeStatOfRoute(const StatRequest &stat_request, router::TransportCat
     return json_builder.Build();
 }
 
+json::Node MakeStatOfMatrix(const StatRequest &stat_request, const router::TransportCatalogueRouter &router) {
+    const std::vector<std::string_view> origins(stat_request.origins.begin(), stat_request.origins.end());
+    const std::vector<std::string_view> destinations(stat_request.destinations.begin(), stat_request.destinations.end());
+    const auto weights = router.BuildMatrix(origins, destinations);
+    auto json_builder = json::Builder{};
+    json_builder.StartDict()
+        .Key("request_id"s).Value(stat_request.id)
+        .Key("total_time"s)
+        .StartArray();
+    for (size_t i = 0; i < origins.size(); ++i) {
+        json_builder.StartArray();
+        for (size_t j = 0; j < destinations.size(); ++j) {
+            // Если маршрута нет, вместо времени выводится null
+            const auto &weight = weights[i * destinations.size() + j];
+            if (weight.has_value()) {
+                json_builder.Value(*weight);
+            } else {
+                json_builder.Value(nullptr);
+            }
+        }
+        json_builder.EndArray();
+    }
+    json_builder.EndArray()
+        .EndDict();
+    return json_builder.Build();
+}
 
+json::Node MakeStatOfIsochrone(const StatRequest &stat_request, const router::TransportCatalogueRouter &router) {
+    const auto stops = router.BuildIsochrone(stat_request.from, stat_request.max_time);
+    if (!stops.has_value()) {
+        return json::Builder{}.StartDict()
+            .Key("request_id"s).Value(stat_request.id)
+            .Key("error_message"s).Value("not found"s)
+            .EndDict()
+            .Build();
+    }
+    auto json_builder = json::Builder{};
+    json_builder.StartDict()
+        .Key("request_id"s).Value(stat_request.id)
+        .Key("stops"s)
+        .StartArray();
+    for (const auto &[stop_ptr, weight]: *stops) {
+        json_builder.StartDict()
+            .Key("stop_name"s).Value(stop_ptr->name)
+            .Key("time"s).Value(weight)
+            .EndDict();
+    }
+    json_builder.EndArray();
+    if (stat_request.with_convex_hull) {
+        std::vector<geo::Coordinates> coordinates;
+        coordinates.reserve(stops->size());
+        for (const auto &[stop_ptr, _]: *stops) {
+            coordinates.push_back(stop_ptr->coordinates);
+        }
+        json_builder.Key("convex_hull"s).StartArray();
+        for (const auto &[lat, lng]: geo::ComputeConvexHull(std::move(coordinates))) {
+            json_builder.StartDict()
+                .Key("latitude"s).Value(lat)
+                .Key("longitude"s).Value(lng)
+                .EndDict();
+        }
+        json_builder.EndArray();
+    }
+    json_builder.EndDict();
+    return json_builder.Build();
+}
 
-json::Document StatRequestsToJSON(const json::Document &doc, const data::TransportCatalogue &catalogue,
-                                  router::TransportCatalogueRouter &router) {
+std::vector<json::Node> MakeStatsOfRoutes(const json::Array &stat_requests, const router::TransportCatalogueRouter &router) {
+    // Запросы Route группируются по остановке отправления: на группу - один поиск из этой остановки
+    std::unordered_map<std::string_view, std::vector<size_t>> requests_by_from;
+    for (size_t i = 0; i < stat_requests.size(); ++i) {
+        const auto &request = stat_requests[i].AsDict();
+        if (request.at("type"s).AsString() == "Route"s) {
+            requests_by_from[request.at("from"s).AsString()].push_back(i);
+        }
+    }
+    std::vector<json::Node> result(stat_requests.size());
+    for (const auto &[from, indexes]: requests_by_from) {
+        std::vector<std::string_view> stops_to;
+        stops_to.reserve(indexes.size());
+        for (const size_t index: indexes) {
+            stops_to.push_back(stat_requests[index].AsDict().at("to"s).AsString());
+        }
+        const auto routes = router.BuildRoutes(from, stops_to);
+        for (size_t i = 0; i < indexes.size(); ++i) {
+            StatRequest stat_request;
+            stat_request.id = stat_requests[indexes[i]].AsDict().at("id"s).AsInt();
+            result[indexes[i]] = MakeStatOfRoute(stat_request, routes[i]);
+        }
+    }
+    return result;
+}
+
+bool HasRoutingRequests(const json::Array &stat_requests) {
+    return std::any_of(stat_requests.begin(), stat_requests.end(), [](const json::Node &request) {
+        const std::string &type = request.AsDict().at("type"s).AsString();
+        return type == "Route"s || type == "Matrix"s || type == "Isochrone"s;
+    });
+}
+
+namespace {
+// router может быть пустым, только если запросов маршрутов нет
+json::Document MakeStatsOfRequests(const json::Document &doc, const data::TransportCatalogue &catalogue,
+                                   const router::TransportCatalogueRouter *router) {
     const json::Array &stat_requests = doc.GetRoot().AsDict().at("stat_requests"s).AsArray();
+    // Ответы на запросы Route считаются заранее пачками и выводятся на своих местах
+    std::vector<json::Node> routes = router != nullptr ? MakeStatsOfRoutes(stat_requests, *router)
+                                                       : std::vector<json::Node>(stat_requests.size());
     auto json_builder = json::Builder{};
     json_builder.StartArray();
-    for (const auto &requests: stat_requests) {
-        const auto &request = requests.AsDict();
+    for (size_t i = 0; i < stat_requests.size(); ++i) {
+        const auto &request = stat_requests[i].AsDict();
         StatRequest stat_request;
         stat_request.id = request.at("id"s).AsInt();
         stat_request.type = request.at("type"s).AsString();
@@ -183,14 +289,42 @@ json::Document StatRequestsToJSON(const json::Document &doc, const data::Transpo
 
             json_builder.Value(MakeStatOfMap(stat_request, map_renderer).GetValue());
         } else if (stat_request.type == "Route"s) {
+            json_builder.Value(std::move(routes[i].GetValue()));
+        } else if (stat_request.type == "Matrix"s) {
+            for (const auto &stop: request.at("origins"s).AsArray()) {
+                stat_request.origins.push_back(stop.AsString());
+            }
+            for (const auto &stop: request.at("destinations"s).AsArray()) {
+                stat_request.destinations.push_back(stop.AsString());
+            }
+            json_builder.Value(MakeStatOfMatrix(stat_request, *router).GetValue());
+        } else if (stat_request.type == "Isochrone"s) {
             stat_request.from = request.at("from"s).AsString();
-            stat_request.to = request.at("to"s).AsString();
-            json_builder.Value(MakeStatOfRoute(stat_request, router).GetValue());
+            stat_request.max_time = request.at("max_time"s).AsDouble();
+            if (request.count("convex_hull"s) > 0) {
+                stat_request.with_convex_hull = request.at("convex_hull"s).AsBool();
+            }
+            json_builder.Value(MakeStatOfIsochrone(stat_request, *router).GetValue());
         }
     }
     json_builder.EndArray();
     return json::Document{json_builder.Build()};
 }
+} // namespace
+
+json::Document StatRequestsToJSON(const json::Document &doc, const data::TransportCatalogue &catalogue,
+                                  const router::TransportCatalogueRouter &router) {
+    return MakeStatsOfRequests(doc, catalogue, &router);
+}
+
+json::Document StatRequestsToJSON(const json::Document &doc, const data::TransportCatalogue &catalogue) {
+    // Построение маршрутизатора - самый долгий этап подготовки, справочным запросам он не нужен
+    if (!HasRoutingRequests(doc.GetRoot().AsDict().at("stat_requests"s).AsArray())) {
+        return MakeStatsOfRequests(doc, catalogue, nullptr);
+    }
+    const router::TransportCatalogueRouter router(catalogue, LoadRoutingSettings(doc));
+    return MakeStatsOfRequests(doc, catalogue, &router);
+}
 
 svg::Color ColorFromJsonToSvg(const json::Node &color) {
     svg::Color result;
@@ -231,11 +365,70 @@ RenderSettings LoadRenderSettings(const json::Document &doc) {
     return result;
 }
 
+RouterEngineType RouterEngineTypeFromString(std::string_view name) {
+    if (name == "all_pairs"sv) {
+        return RouterEngineType::ALL_PAIRS;
+    }
+    if (name == "dijkstra"sv) {
+        return RouterEngineType::DIJKSTRA;
+    }
+    if (name == "contraction_hierarchies"sv) {
+        return RouterEngineType::CONTRACTION_HIERARCHIES;
+    }
+    if (name == "a_star"sv) {
+        return RouterEngineType::A_STAR;
+    }
+    if (name == "alt"sv) {
+        return RouterEngineType::ALT;
+    }
+    if (name == "raptor"sv) {
+        return RouterEngineType::RAPTOR;
+    }
+    if (name == "hub_labels"sv) {
+        return RouterEngineType::HUB_LABELS;
+    }
+    if (name == "customizable_route_planning"sv) {
+        return RouterEngineType::CUSTOMIZABLE_ROUTE_PLANNING;
+    }
+    throw std::invalid_argument("Unknown router engine: "s + std::string(name));
+}
+
+RouterGraphModel RouterGraphModelFromString(std::string_view name) {
+    if (name == "stop_pairs"sv) {
+        return RouterGraphModel::STOP_PAIRS;
+    }
+    if (name == "bus_lines"sv) {
+        return RouterGraphModel::BUS_LINES;
+    }
+    throw std::invalid_argument("Unknown router graph model: "s + std::string(name));
+}
+
 RoutingSettings LoadRoutingSettings(const json::Document &doc) {
     RoutingSettings result;
     const json::Dict &routing_settings = doc.GetRoot().AsDict().at("routing_settings"s).AsDict();
     result.bus_wait_time = routing_settings.at("bus_wait_time"s).AsInt();
     result.bus_velocity = routing_settings.at("bus_velocity"s).AsDouble();
+    if (routing_settings.count("router_engine"s) > 0) {
+        result.router_engine = RouterEngineTypeFromString(routing_settings.at("router_engine"s).AsString());
+    }
+    if (routing_settings.count("graph_model"s) > 0) {
+        result.graph_model = RouterGraphModelFromString(routing_settings.at("graph_model"s).AsString());
+    }
+    if (routing_settings.count("route_cache_size"s) > 0) {
+        result.route_cache_size = std::max(routing_settings.at("route_cache_size"s).AsInt(), 0);
+    }
+    if (routing_settings.count("router_thread_count"s) > 0) {
+        result.router_thread_count = std::max(routing_settings.at("router_thread_count"s).AsInt(), 1);
+    }
+    if (routing_settings.count("landmark_count"s) > 0) {
+        result.landmark_count = std::max(routing_settings.at("landmark_count"s).AsInt(), 0);
+    }
+    if (routing_settings.count("weight_units_per_minute"s) > 0) {
+        result.weight_units_per_minute = std::max(routing_settings.at("weight_units_per_minute"s).AsInt(), 0);
+    }
+    if (routing_settings.count("hub_labels_path"s) > 0) {
+        result.hub_labels_path = routing_settings.at("hub_labels_path"s).AsString();
+    }
     return result;
 }
 } // namespace request
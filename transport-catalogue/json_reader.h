@@ -27,14 +27,33 @@ json::Node MakeStatOfStop(const StatRequest& stat_request, const data::Transport
 
 json::Node MakeStatOfMap(const StatRequest &stat_request, render::MapRenderer &map_renderer);
 
-json::Node MakeStatOfRoute(const StatRequest &stat_request, router::TransportCatalogueRouter &router);
+json::Node MakeStatOfRoute(const StatRequest &stat_request, const router::TransportCatalogueRouter &router);
 
-json::Document StatRequestsToJSON(const json::Document &doc, const data::TransportCatalogue &catalogue, router::TransportCatalogueRouter &router);
+json::Node MakeStatOfRoute(const StatRequest &stat_request, const std::optional<StatRouteInfo> &route);
+
+json::Node MakeStatOfMatrix(const StatRequest &stat_request, const router::TransportCatalogueRouter &router);
+
+json::Node MakeStatOfIsochrone(const StatRequest &stat_request, const router::TransportCatalogueRouter &router);
+
+// Ответы на все запросы Route из stat_requests по их позициям (на остальных позициях - пустые узлы)
+std::vector<json::Node> MakeStatsOfRoutes(const json::Array &stat_requests, const router::TransportCatalogueRouter &router);
+
+// Есть ли среди stat_requests запросы, которым нужен маршрутизатор: Route, Matrix или Isochrone
+bool HasRoutingRequests(const json::Array &stat_requests);
+
+json::Document StatRequestsToJSON(const json::Document &doc, const data::TransportCatalogue &catalogue, const router::TransportCatalogueRouter &router);
+
+// Маршрутизатор по "routing_settings" строится, только если он нужен хотя бы одному запросу
+json::Document StatRequestsToJSON(const json::Document &doc, const data::TransportCatalogue &catalogue);
 
 svg::Color ColorFromJsonToSvg(const json::Node &color);
 
 RenderSettings LoadRenderSettings(const json::Document& doc);
 
+RouterEngineType RouterEngineTypeFromString(std::string_view name);
+
+RouterGraphModel RouterGraphModelFromString(std::string_view name);
+
 RoutingSettings LoadRoutingSettings(const json::Document& doc);
 
 } // namespace request
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace cache {
+
+struct CacheStats {
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+    size_t size = 0;
+};
+
+// Кэш ограниченного размера с вытеснением давно не использованных значений (LRU).
+// Элементы хранятся в списке от недавно использованных к давно использованным,
+// хеш-таблица по ключу указывает на элемент списка
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity = 0)
+        : capacity_(capacity) {
+    }
+
+    // Значение по ключу или nullptr. Найденное значение становится самым недавно использованным
+    const Value* Find(const Key& key);
+
+    // При нулевой ёмкости кэш ничего не хранит
+    void Put(const Key& key, Value value);
+
+    // Удаляет все значения, счётчики попаданий и промахов сохраняются
+    void Clear();
+
+    CacheStats GetStats() const {
+        return {hit_count_, miss_count_, items_.size()};
+    }
+
+private:
+    using Item = std::pair<Key, Value>;
+
+    size_t capacity_;
+    std::list<Item> items_;
+    std::unordered_map<Key, typename std::list<Item>::iterator, Hash> positions_;
+    size_t hit_count_ = 0;
+    size_t miss_count_ = 0;
+};
+
+template <typename Key, typename Value, typename Hash>
+const Value* LruCache<Key, Value, Hash>::Find(const Key& key) {
+    const auto it = positions_.find(key);
+    if (it == positions_.end()) {
+        ++miss_count_;
+        return nullptr;
+    }
+    ++hit_count_;
+    items_.splice(items_.begin(), items_, it->second);
+    return &it->second->second;
+}
+
+template <typename Key, typename Value, typename Hash>
+void LruCache<Key, Value, Hash>::Put(const Key& key, Value value) {
+    if (capacity_ == 0) {
+        return;
+    }
+    if (const auto it = positions_.find(key); it != positions_.end()) {
+        it->second->second = std::move(value);
+        items_.splice(items_.begin(), items_, it->second);
+        return;
+    }
+    if (items_.size() == capacity_) {
+        positions_.erase(items_.back().first);
+        items_.pop_back();
+    }
+    items_.emplace_front(key, std::move(value));
+    positions_.emplace(key, items_.begin());
+}
+
+template <typename Key, typename Value, typename Hash>
+void LruCache<Key, Value, Hash>::Clear() {
+    items_.clear();
+    positions_.clear();
+}
+
+}  // namespace cache
@@ -18,10 +18,8 @@ int main() {
     const auto json_requests_doc = json::Load(input_stream);
     data::TransportCatalogue catalogue = request::MakeCatalogueFromJSON(json_requests_doc);
 
-    // Парсим "routing_settings", создаем объект TransportCatalogueRouter
-    router::TransportCatalogueRouter router = request::MakeCatatalogueRouter(json_requests_doc, catalogue);
-
-    // Парсим запросы к каталогу, создаем json документ с ответами и отправляем его в stdout
-    const auto json_stat_doc = request::StatRequestsToJSON(json_requests_doc, catalogue, router);
+    // Парсим запросы к каталогу, создаем json документ с ответами и отправляем его в stdout.
+    // Объект TransportCatalogueRouter по "routing_settings" создается, только если есть запросы маршрутов
+    const auto json_stat_doc = request::StatRequestsToJSON(json_requests_doc, catalogue);
     json::Print(json_stat_doc, std::cout);
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+// Выполняет задачи с номерами от 0 до task_count на thread_count потоках, считая вызывающий.
+// Потоки берут номера задач по одному из общего счётчика. make_worker вызывается один раз в каждом потоке
+// и возвращает функцию от номера задачи, поэтому у потока может быть своё состояние, например буфер поиска.
+// Первое исключение останавливает раздачу задач и передаётся вызывающему, когда все потоки завершатся
+template <typename MakeWorker>
+void ParallelFor(size_t task_count, size_t thread_count, const MakeWorker& make_worker) {
+    std::atomic<size_t> next_task = 0;
+    std::exception_ptr exception;
+    std::mutex exception_mutex;
+    const auto run_tasks = [&] {
+        try {
+            auto worker = make_worker();
+            for (size_t task = next_task++; task < task_count; task = next_task++) {
+                worker(task);
+            }
+        } catch (...) {
+            std::lock_guard lock(exception_mutex);
+            if (!exception) {
+                exception = std::current_exception();
+            }
+            next_task = task_count;
+        }
+    };
+
+    thread_count = std::clamp<size_t>(thread_count, 1, std::max<size_t>(task_count, 1));
+    std::vector<std::thread> workers;
+    workers.reserve(thread_count - 1);
+    try {
+        for (size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+            workers.emplace_back(run_tasks);
+        }
+    } catch (...) {
+        next_task = task_count;
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        throw;
+    }
+    run_tasks();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+}  // namespace concurrency
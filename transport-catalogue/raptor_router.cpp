@@ -0,0 +1,231 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace router {
+
+namespace {
+constexpr double INFINITE_WEIGHT = std::numeric_limits<double>::infinity();
+} // namespace
+
+RaptorRouter::RaptorRouter(const data::TransportCatalogue &catalogue, const double bus_velocity,
+                           const double bus_wait_time)
+    : catalogue_(catalogue)
+      , bus_velocity_(bus_velocity)
+      , bus_wait_time_(bus_wait_time) {
+    for (const auto &[_, bus_ptr]: catalogue_.GetBuses()) {
+        const size_t route_size = bus_ptr->route.size();
+        if (route_size == 0) {
+            continue;
+        }
+        if (bus_ptr->is_roundtrip) {
+            AddLine(bus_ptr, 0, route_size);
+        } else {
+            const size_t middle = route_size / 2;
+            AddLine(bus_ptr, 0, middle + 1);
+            AddLine(bus_ptr, middle, route_size);
+        }
+    }
+}
+
+void RaptorRouter::AddLine(const data::Bus *bus_ptr, const size_t begin, const size_t end) {
+    const size_t line_index = lines_.size();
+    Line line{bus_ptr, begin, {}, {}};
+    for (size_t position = begin; position < end; ++position) {
+        const data::Stop *stop_ptr = bus_ptr->route[position];
+        const auto [it, is_inserted] = stops_indexes_.emplace(stop_ptr, stops_indexes_.size());
+        if (is_inserted) {
+            stops_lines_.emplace_back();
+            stops_.push_back(stop_ptr);
+        }
+        stops_lines_[it->second].push_back(LineStop{line_index, position - begin});
+        line.stops_indexes.push_back(it->second);
+        if (position + 1 < end) {
+            line.segments_weights.push_back(catalogue_.GetDistance(stop_ptr, bus_ptr->route[position + 1]) / bus_velocity_);
+        }
+    }
+    lines_.push_back(std::move(line));
+}
+
+void RaptorRouter::UpdateStopsDistance(const data::Stop *stop_ptr_1, const data::Stop *stop_ptr_2) {
+    const auto it = stops_indexes_.find(stop_ptr_1);
+    if (it == stops_indexes_.end()) {
+        return;
+    }
+    // Достаточно просмотреть перегоны у всех вхождений первой остановки в линии
+    for (const auto &[line_index, position]: stops_lines_[it->second]) {
+        Line &line = lines_[line_index];
+        const auto &route = line.bus_ptr->route;
+        const size_t route_position = line.begin + position;
+        if (position > 0 && route[route_position - 1] == stop_ptr_2) {
+            line.segments_weights[position - 1] = catalogue_.GetDistance(stop_ptr_2, stop_ptr_1) / bus_velocity_;
+        }
+        if (position + 1 < line.stops_indexes.size() && route[route_position + 1] == stop_ptr_2) {
+            line.segments_weights[position] = catalogue_.GetDistance(stop_ptr_1, stop_ptr_2) / bus_velocity_;
+        }
+    }
+}
+
+void RaptorRouter::SetBusWaitTime(const double bus_wait_time) {
+    bus_wait_time_ = bus_wait_time;
+}
+
+void RaptorRouter::SetBusVelocity(const double bus_velocity) {
+    bus_velocity_ = bus_velocity;
+    for (Line &line: lines_) {
+        const auto &route = line.bus_ptr->route;
+        for (size_t position = 0; position < line.segments_weights.size(); ++position) {
+            const size_t route_position = line.begin + position;
+            line.segments_weights[position] =
+                catalogue_.GetDistance(route[route_position], route[route_position + 1]) / bus_velocity_;
+        }
+    }
+}
+
+std::optional<request::StatRouteInfo> RaptorRouter::BuildRoute(const std::string_view from,
+                                                                const std::string_view to) const {
+    const auto from_it = stops_indexes_.find(catalogue_.GetStop(from));
+    const auto to_it = stops_indexes_.find(catalogue_.GetStop(to));
+    if (from_it == stops_indexes_.end() || to_it == stops_indexes_.end()) {
+        return std::nullopt;
+    }
+    const size_t target_index = to_it->second;
+    const auto search = search_spaces_.Acquire();
+    const size_t round = Search(*search, from_it->second, target_index, INFINITE_WEIGHT);
+    const std::vector<double> &arrivals = search->arrivals[round];
+
+    if (arrivals[target_index] == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+    request::StatRouteInfo result;
+    result.weight = arrivals[target_index];
+    size_t stop_index = target_index;
+    for (size_t current_round = round; current_round > 0; --current_round) {
+        // Если в этом раунде остановка не улучшалась, её время унаследовано от предыдущего
+        if (const auto &label = search->labels[current_round][stop_index]) {
+            const Line &line = lines_[label->line_index];
+            const data::Stop *board_stop_ptr = line.bus_ptr->route[line.begin + label->board_position];
+            result.route.emplace_back(request::Route{
+                false, nullptr, line.bus_ptr, label->ride_weight, label->span_count});
+            result.route.emplace_back(request::Route{true, board_stop_ptr, nullptr, bus_wait_time_, 0});
+            stop_index = line.stops_indexes[label->board_position];
+        }
+    }
+    std::reverse(result.route.begin(), result.route.end());
+    return result;
+}
+
+std::optional<std::vector<request::ReachableStop> > RaptorRouter::BuildReachable(const std::string_view from,
+                                                                                 const double max_weight) const {
+    const auto from_it = stops_indexes_.find(catalogue_.GetStop(from));
+    if (from_it == stops_indexes_.end()) {
+        return std::nullopt;
+    }
+    std::vector<request::ReachableStop> result;
+    if (max_weight < 0) {
+        return result;
+    }
+    const auto search = search_spaces_.Acquire();
+    const size_t round = Search(*search, from_it->second, std::nullopt, max_weight);
+    const std::vector<double> &arrivals = search->arrivals[round];
+    for (size_t stop_index = 0; stop_index < stops_.size(); ++stop_index) {
+        if (arrivals[stop_index] <= max_weight) {
+            result.push_back(request::ReachableStop{stops_[stop_index], arrivals[stop_index]});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const request::ReachableStop &lhs, const request::ReachableStop &rhs) {
+        return lhs.weight < rhs.weight || (lhs.weight == rhs.weight && lhs.stop->name < rhs.stop->name);
+    });
+    return result;
+}
+
+size_t RaptorRouter::Search(SearchSpace &search, const size_t from_index, const std::optional<size_t> target_index,
+                            const double max_weight) const {
+    const size_t stop_count = stops_lines_.size();
+
+    search.arrivals.resize(1);
+    search.labels.resize(1);
+    search.arrivals[0].assign(stop_count, INFINITE_WEIGHT);
+    search.labels[0].assign(stop_count, std::nullopt);
+    search.arrivals[0][from_index] = 0;
+    search.is_marked.assign(stop_count, false);
+    search.marked_stops.assign(1, from_index);
+    search.is_marked[from_index] = true;
+    search.lines_start_positions.assign(lines_.size(), std::nullopt);
+
+    size_t round = 0;
+    while (!search.marked_stops.empty()) {
+        ++round;
+        if (search.arrivals.size() <= round) {
+            search.arrivals.emplace_back();
+            search.labels.emplace_back();
+        }
+        search.arrivals[round] = search.arrivals[round - 1];
+        search.labels[round].assign(stop_count, std::nullopt);
+
+        // Каждую линию достаточно просмотреть один раз с самой ранней отмеченной остановки
+        search.lines_to_scan.clear();
+        for (const size_t stop_index: search.marked_stops) {
+            search.is_marked[stop_index] = false;
+            for (const auto &[line_index, position]: stops_lines_[stop_index]) {
+                auto &start_position = search.lines_start_positions[line_index];
+                if (!start_position) {
+                    search.lines_to_scan.push_back(line_index);
+                    start_position = position;
+                } else {
+                    start_position = std::min(*start_position, position);
+                }
+            }
+        }
+        search.marked_stops.clear();
+        for (const size_t line_index: search.lines_to_scan) {
+            ScanLine(search, line_index, *search.lines_start_positions[line_index], round, target_index, max_weight);
+            search.lines_start_positions[line_index].reset();
+        }
+    }
+    return round;
+}
+
+void RaptorRouter::ScanLine(SearchSpace &search, const size_t line_index, const size_t start_position, const size_t round,
+                            const std::optional<size_t> target_index, const double max_weight) const {
+    const Line &line = lines_[line_index];
+    const std::vector<double> &prev_arrivals = search.arrivals[round - 1];
+    std::vector<double> &arrivals = search.arrivals[round];
+    std::vector<std::optional<Label>> &labels = search.labels[round];
+
+    std::optional<size_t> board_position;
+    double board_weight = 0;
+    double ride_weight = 0;
+    int span_count = 0;
+    for (size_t position = start_position; position < line.stops_indexes.size(); ++position) {
+        const size_t stop_index = line.stops_indexes[position];
+        if (board_position) {
+            ride_weight += line.segments_weights[position - 1];
+            ++span_count;
+            const double arrival = board_weight + ride_weight;
+            // Время хуже уже найденного до цели или за пределами бюджета ничего не даст
+            if (stop_index != line.stops_indexes[*board_position]
+                && arrival < arrivals[stop_index] && arrival <= max_weight
+                && (!target_index || arrival < arrivals[*target_index])) {
+                arrivals[stop_index] = arrival;
+                labels[stop_index] = Label{line_index, *board_position, ride_weight, span_count};
+                if (!search.is_marked[stop_index]) {
+                    search.is_marked[stop_index] = true;
+                    search.marked_stops.push_back(stop_index);
+                }
+            }
+        }
+        // Пересесть на этот же автобус заново выгодно, если на остановку приехали раньше, чем он
+        const double board_candidate = prev_arrivals[stop_index] + bus_wait_time_;
+        if (prev_arrivals[stop_index] < INFINITE_WEIGHT
+            && (!board_position || board_candidate < board_weight + ride_weight)) {
+            board_position = position;
+            board_weight = board_candidate;
+            ride_weight = 0;
+            span_count = 0;
+        }
+    }
+}
+
+} // namespace router
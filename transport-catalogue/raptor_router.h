@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "scratch_pool.h"
+#include "transport_catalogue.h"
+
+namespace router {
+
+// Поиск маршрута по раундам в стиле RAPTOR прямо по маршрутам автобусов из каталога,
+// без построения графа. В k-м раунде находятся лучшие времена прибытия на остановки
+// не более чем с k поездками: каждая линия просматривается один раз от первой остановки,
+// на которой можно сесть, а каждая посадка стоит одного ожидания bus_wait_time.
+// Запросы можно выполнять из нескольких потоков одновременно.
+class RaptorRouter {
+public:
+    // bus_velocity - скорость автобуса в метрах в минуту, bus_wait_time - ожидание в минутах
+    RaptorRouter(const data::TransportCatalogue &catalogue, double bus_velocity, double bus_wait_time);
+
+    std::optional<request::StatRouteInfo> BuildRoute(std::string_view from, std::string_view to) const;
+
+    // Остановки, до которых можно добраться не дольше чем за max_weight, в порядке возрастания времени.
+    // Пусто, если остановки from нет или через неё не проходит ни один автобус
+    std::optional<std::vector<request::ReachableStop> > BuildReachable(std::string_view from, double max_weight) const;
+
+    // Пересчитывает время перегонов между остановками после изменения расстояния между ними в каталоге
+    void UpdateStopsDistance(const data::Stop *stop_ptr_1, const data::Stop *stop_ptr_2);
+
+    void SetBusWaitTime(double bus_wait_time);
+
+    // bus_velocity - скорость автобуса в метрах в минуту, пересчитывается время всех перегонов
+    void SetBusVelocity(double bus_velocity);
+
+private:
+    // Направление маршрута автобуса: участок Bus::route, начинающийся с позиции begin.
+    // У некольцевого маршрута два направления, средняя остановка входит в оба
+    struct Line {
+        const data::Bus *bus_ptr;
+        size_t begin;
+        std::vector<size_t> stops_indexes;
+        // Время в пути от позиции i до позиции i + 1
+        std::vector<double> segments_weights;
+    };
+
+    struct LineStop {
+        size_t line_index;
+        size_t position;
+    };
+
+    // Как остановка была достигнута в раунде: поездкой по линии с посадкой на позиции board_position
+    struct Label {
+        size_t line_index;
+        size_t board_position;
+        double ride_weight;
+        int span_count;
+    };
+
+    // Буферы запроса: времена прибытия и метки по раундам, отмеченные остановки и начала просмотра линий
+    struct SearchSpace {
+        std::vector<std::vector<double>> arrivals;
+        std::vector<std::vector<std::optional<Label>>> labels;
+        std::vector<size_t> marked_stops;
+        std::vector<bool> is_marked;
+        std::vector<size_t> lines_to_scan;
+        std::vector<std::optional<size_t>> lines_start_positions;
+    };
+
+    void AddLine(const data::Bus *bus_ptr, size_t begin, size_t end);
+
+    // Раунды поиска из from_index. Остановки позже max_weight и позже уже найденного времени до цели
+    // не улучшаются. Возвращает номер последнего раунда: в search.arrivals этого раунда лучшие времена
+    size_t Search(SearchSpace &search, size_t from_index, std::optional<size_t> target_index, double max_weight) const;
+
+    void ScanLine(SearchSpace &search, size_t line_index, size_t start_position, size_t round,
+                  std::optional<size_t> target_index, double max_weight) const;
+
+    const data::TransportCatalogue &catalogue_;
+    double bus_velocity_;
+    double bus_wait_time_;
+    std::vector<Line> lines_;
+    std::unordered_map<const data::Stop *, size_t> stops_indexes_;
+    std::vector<const data::Stop *> stops_;
+    std::vector<std::vector<LineStop>> stops_lines_;
+    concurrency::ScratchPool<SearchSpace> search_spaces_{[] {
+        return std::make_unique<SearchSpace>();
+    }};
+};
+
+} // namespace router
@@ -4,114 +4,476 @@
 
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+namespace detail {
+
+// Многоразовый барьер: потоки ждут друг друга перед переходом к следующей итерации
+class Barrier {
+public:
+    explicit Barrier(size_t participant_count)
+        : participant_count_(participant_count) {
+    }
+
+    // Возвращает false, если барьер сломан вызовом Break и продолжать работу нельзя
+    bool ArriveAndWait() {
+        std::unique_lock lock(mutex_);
+        const size_t generation = generation_;
+        if (++waiting_count_ == participant_count_) {
+            waiting_count_ = 0;
+            ++generation_;
+            condition_.notify_all();
+        } else {
+            condition_.wait(lock, [this, generation] {
+                return generation != generation_ || is_broken_;
+            });
+        }
+        return !is_broken_;
+    }
+
+    void Break() {
+        std::lock_guard lock(mutex_);
+        is_broken_ = true;
+        condition_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    const size_t participant_count_;
+    size_t waiting_count_ = 0;
+    size_t generation_ = 0;
+    bool is_broken_ = false;
+};
+
+}  // namespace detail
+
+template <typename Weight>
+struct RouteInfo {
+    Weight weight;
+    std::vector<EdgeId> edges;
+};
+
+// Изменение веса ребра: новый вес уже записан в граф, old_weight - прежний
 template <typename Weight>
-class Router {
+struct EdgeWeightChange {
+    EdgeId edge_id;
+    Weight old_weight;
+};
+
+// Общий интерфейс движков маршрутизации, которые отвечают на запрос BuildRoute(from, to)
+template <typename Weight>
+class RouterEngine {
+public:
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    virtual ~RouterEngine() = default;
+
+    virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+    // Маршруты из одной вершины во все вершины targets, в том же порядке.
+    // По умолчанию это отдельный запрос на каждую цель; движки с поиском от источника
+    // переопределяют метод и обходятся одним поиском
+    virtual std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                              const std::vector<VertexId>& targets) const {
+        std::vector<std::optional<RouteInfo>> result;
+        result.reserve(targets.size());
+        for (const VertexId to : targets) {
+            result.push_back(BuildRoute(from, to));
+        }
+        return result;
+    }
+
+    // Веса маршрутов из каждой вершины sources в каждую вершину targets без самих маршрутов,
+    // построчно: [i * targets.size() + j]. Пусто, если маршрута нет
+    virtual std::vector<std::optional<Weight>> BuildWeightsMatrix(const std::vector<VertexId>& sources,
+                                                                  const std::vector<VertexId>& targets) const {
+        std::vector<std::optional<Weight>> result;
+        result.reserve(sources.size() * targets.size());
+        for (const VertexId from : sources) {
+            for (const auto& route : BuildRoutes(from, targets)) {
+                result.push_back(route ? std::optional<Weight>(route->weight) : std::nullopt);
+            }
+        }
+        return result;
+    }
+
+    // Сообщает движку, что веса рёбер в графе изменились. Возвращает false, если движок
+    // не умеет подстраиваться под новые веса и его нужно построить заново
+    virtual bool UpdateEdgeWeights([[maybe_unused]] const std::vector<EdgeWeightChange<Weight>>& changes) {
+        return false;
+    }
+};
+
+// Предрасчёт маршрутов между всеми парами вершин алгоритмом Флойда-Уоршелла
+template <typename Weight>
+class Router final : public RouterEngine<Weight> {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
-    explicit Router(const Graph& graph);
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
 
-    struct RouteInfo {
-        Weight weight;
-        std::vector<EdgeId> edges;
-    };
+    // thread_count потоков делят между собой строки таблицы на каждой итерации Флойда-Уоршелла.
+    // Каждая ячейка пересчитывается теми же операциями в том же порядке, поэтому результат
+    // не зависит от числа потоков
+    explicit Router(const Graph& graph, size_t thread_count = 1);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    // Веса берутся прямо из таблицы
+    std::vector<std::optional<Weight>> BuildWeightsMatrix(const std::vector<VertexId>& sources,
+                                                          const std::vector<VertexId>& targets) const override;
+
+    // Таблица чинится без полного пересчёта. В строках, где дерево кратчайших путей проходило
+    // по подорожавшему ребру, поиском Дейкстры пересчитываются только вершины под этим ребром.
+    // Затем через каждое подешевевшее ребро (u, v) релаксируются все строки:
+    // d(s, t) = min(d(s, t), d(s, u) + w + d(v, t))
+    bool UpdateEdgeWeights(const std::vector<EdgeWeightChange<Weight>>& changes) override;
 
 private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
-    };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    // Таблица маршрутов хранится построчно в двух плотных массивах размера V*V:
+    // веса (INFINITE_WEIGHT - маршрута нет) и последние рёбра маршрутов (NO_EDGE - ребра нет)
+    using CompactEdgeId = std::uint32_t;
+
+    // У целых типов бесконечности нет, поэтому берётся половина диапазона: сумма двух весов
+    // таблицы не переполняется и не меньше INFINITE_WEIGHT, если одно из слагаемых бесконечно.
+    // Веса настоящих маршрутов должны быть меньше INFINITE_WEIGHT
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+                                              ? std::numeric_limits<Weight>::infinity()
+                                              : std::numeric_limits<Weight>::max() / 2;
+    static constexpr CompactEdgeId NO_EDGE = std::numeric_limits<CompactEdgeId>::max();
+
+    size_t GetIndex(VertexId vertex_from, VertexId vertex_to) const {
+        return vertex_from * vertex_count_ + vertex_to;
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for the route table");
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[GetIndex(vertex, vertex)] = ZERO_WEIGHT;
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const size_t index = GetIndex(vertex, edge.to);
+                if (edge.weight < weights_[index]) {
+                    weights_[index] = edge.weight;
+                    prev_edges_[index] = static_cast<CompactEdgeId>(edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    // На итерации vertex_through строка vertex_through не меняется, поэтому строки
+    // [rows_begin, rows_end) можно пересчитывать независимо от остальных
+    void RelaxRoutesInternalDataThroughVertex(VertexId vertex_through, VertexId rows_begin, VertexId rows_end) {
+        const Weight* weights_through = weights_.data() + GetIndex(vertex_through, 0);
+        const CompactEdgeId* prev_edges_through = prev_edges_.data() + GetIndex(vertex_through, 0);
+        for (VertexId vertex_from = rows_begin; vertex_from < rows_end; ++vertex_from) {
+            const Weight weight_from = weights_[GetIndex(vertex_from, vertex_through)];
+            // Строка самой вершины vertex_through не меняется, а недостижимые строки пропускаем
+            if (vertex_from == vertex_through || !(weight_from < INFINITE_WEIGHT)) {
+                continue;
+            }
+            const CompactEdgeId prev_edge_from = prev_edges_[GetIndex(vertex_from, vertex_through)];
+            Weight* weights_relaxing = weights_.data() + GetIndex(vertex_from, 0);
+            CompactEdgeId* prev_edges_relaxing = prev_edges_.data() + GetIndex(vertex_from, 0);
+            // Сложение с INFINITE_WEIGHT не даёт веса меньше INFINITE_WEIGHT, поэтому отдельная проверка
+            // наличия маршрута не нужна, и на целевых платформах с маскированной записью (AVX2, AVX-512)
+            // цикл векторизуется. Для 32-битных целых весов в вектор помещается вдвое больше ячеек, чем для double
+            for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+                const Weight candidate_weight = weight_from + weights_through[vertex_to];
+                if (candidate_weight < weights_relaxing[vertex_to]) {
+                    weights_relaxing[vertex_to] = candidate_weight;
+                    const CompactEdgeId prev_edge_to = prev_edges_through[vertex_to];
+                    prev_edges_relaxing[vertex_to] = prev_edge_to != NO_EDGE ? prev_edge_to : prev_edge_from;
+                }
+            }
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
+    void RelaxRoutesInternalData(size_t thread_count) {
+        thread_count = std::clamp<size_t>(thread_count, 1, std::max<size_t>(vertex_count_, 1));
+        if (thread_count == 1) {
+            for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+                RelaxRoutesInternalDataThroughVertex(vertex_through, 0, vertex_count_);
+            }
+            return;
+        }
+
+        detail::Barrier barrier(thread_count);
+        const auto relax_rows = [this, &barrier](VertexId rows_begin, VertexId rows_end) {
+            for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+                RelaxRoutesInternalDataThroughVertex(vertex_through, rows_begin, rows_end);
+                if (!barrier.ArriveAndWait()) {
+                    return;
                 }
             }
+        };
+        const auto get_rows_begin = [this, thread_count](size_t thread_index) {
+            return vertex_count_ * thread_index / thread_count;
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(thread_count - 1);
+        try {
+            for (size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+                workers.emplace_back(relax_rows, get_rows_begin(thread_index), get_rows_begin(thread_index + 1));
+            }
+        } catch (...) {
+            barrier.Break();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            throw;
+        }
+        relax_rows(get_rows_begin(0), get_rows_begin(1));
+        for (auto& worker : workers) {
+            worker.join();
         }
     }
 
+    // Пересчитывает в строке vertex_from маршруты, которые проходили по подорожавшим рёбрам
+    void RepairRow(VertexId vertex_from, const std::vector<bool>& is_edge_increased);
+
+    // Маршруты всех строк, которые становятся короче при проезде через ребро edge_id
+    void RelaxRoutesThroughEdge(EdgeId edge_id);
+
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    const size_t vertex_count_;
+    std::vector<Weight> weights_;
+    std::vector<CompactEdgeId> prev_edges_;
+    // Входящие рёбра вершин, строятся при первом обновлении весов
+    std::vector<std::vector<EdgeId>> incoming_edges_;
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+Router<Weight>::Router(const Graph& graph, size_t thread_count)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , vertex_count_(graph.GetVertexCount())
+    , weights_(vertex_count_ * vertex_count_, INFINITE_WEIGHT)
+    , prev_edges_(vertex_count_ * vertex_count_, NO_EDGE)
 {
     InitializeRoutesInternalData(graph);
-
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
-    }
+    RelaxRoutesInternalData(thread_count);
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+    const size_t index = GetIndex(from, to);
+    if (!(weights_[index] < INFINITE_WEIGHT)) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
+    const Weight weight = weights_[index];
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (CompactEdgeId edge_id = prev_edges_[index];
+         edge_id != NO_EDGE;
+         edge_id = prev_edges_[GetIndex(from, graph_.GetEdge(edge_id).from)])
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
     return RouteInfo{weight, std::move(edges)};
 }
 
+template <typename Weight>
+bool Router<Weight>::UpdateEdgeWeights(const std::vector<EdgeWeightChange<Weight>>& changes) {
+    for (const auto& change : changes) {
+        if (graph_.GetEdge(change.edge_id).weight < ZERO_WEIGHT) {
+            return false;
+        }
+    }
+    if (incoming_edges_.empty()) {
+        incoming_edges_.resize(vertex_count_);
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            incoming_edges_[graph_.GetEdge(edge_id).to].push_back(edge_id);
+        }
+    }
+    // Строка s не меняется от подорожания ребра (u, v), если её маршрут до v идёт не по нему
+    std::vector<bool> is_edge_increased(graph_.GetEdgeCount(), false);
+    std::vector<bool> is_row_affected(vertex_count_, false);
+    for (const auto& [edge_id, old_weight] : changes) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (!(old_weight < edge.weight)) {
+            continue;
+        }
+        is_edge_increased[edge_id] = true;
+        for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+            if (prev_edges_[GetIndex(vertex_from, edge.to)] == edge_id) {
+                is_row_affected[vertex_from] = true;
+            }
+        }
+    }
+    for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+        if (is_row_affected[vertex_from]) {
+            RepairRow(vertex_from, is_edge_increased);
+        }
+    }
+    // Кратчайший маршрут проходит каждое ребро не больше раза, поэтому после релаксации
+    // через каждое подешевевшее ребро по очереди таблица снова точна
+    for (const auto& [edge_id, old_weight] : changes) {
+        if (graph_.GetEdge(edge_id).weight < old_weight) {
+            RelaxRoutesThroughEdge(edge_id);
+        }
+    }
+    return true;
+}
+
+template <typename Weight>
+void Router<Weight>::RepairRow(VertexId vertex_from, const std::vector<bool>& is_edge_increased) {
+    enum class State : std::uint8_t {
+        UNKNOWN,
+        CLEAN,
+        AFFECTED
+    };
+    Weight* weights = weights_.data() + GetIndex(vertex_from, 0);
+    CompactEdgeId* prev_edges = prev_edges_.data() + GetIndex(vertex_from, 0);
+
+    // Вершина затронута, если её маршрут проходит по подорожавшему ребру. Цепочки рёбер
+    // маршрутов просматриваются до первой вершины с уже известным состоянием
+    std::vector<State> states(vertex_count_, State::UNKNOWN);
+    std::vector<VertexId> chain;
+    std::vector<VertexId> affected_vertexes;
+    for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+        VertexId vertex = vertex_to;
+        State state = State::UNKNOWN;
+        chain.clear();
+        while (state == State::UNKNOWN) {
+            if (states[vertex] != State::UNKNOWN) {
+                state = states[vertex];
+                break;
+            }
+            chain.push_back(vertex);
+            const CompactEdgeId edge_id = prev_edges[vertex];
+            if (edge_id == NO_EDGE) {
+                state = State::CLEAN;
+            } else if (is_edge_increased[edge_id]) {
+                state = State::AFFECTED;
+            } else {
+                vertex = graph_.GetEdge(edge_id).from;
+            }
+        }
+        for (const VertexId chain_vertex : chain) {
+            states[chain_vertex] = state;
+            if (state == State::AFFECTED) {
+                affected_vertexes.push_back(chain_vertex);
+            }
+        }
+    }
+    if (affected_vertexes.empty()) {
+        return;
+    }
+
+    // Маршруты до незатронутых вершин остались кратчайшими. Затронутые получают начальный вес
+    // по лучшему ребру из незатронутой вершины, после чего поиск Дейкстры идёт только по затронутым
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::vector<QueueItem> queue;
+    for (const VertexId vertex : affected_vertexes) {
+        weights[vertex] = INFINITE_WEIGHT;
+        prev_edges[vertex] = NO_EDGE;
+    }
+    for (const VertexId vertex : affected_vertexes) {
+        for (const EdgeId edge_id : incoming_edges_[vertex]) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            if (states[edge.from] == State::CLEAN && weights[edge.from] + edge.weight < weights[vertex]) {
+                weights[vertex] = weights[edge.from] + edge.weight;
+                prev_edges[vertex] = static_cast<CompactEdgeId>(edge_id);
+            }
+        }
+        if (weights[vertex] < INFINITE_WEIGHT) {
+            queue.emplace_back(weights[vertex], vertex);
+        }
+    }
+    std::make_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        const auto [weight, vertex] = queue.back();
+        queue.pop_back();
+        if (weights[vertex] < weight) {
+            continue;
+        }
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = weight + edge.weight;
+            if (states[edge.to] == State::AFFECTED && candidate_weight < weights[edge.to]) {
+                weights[edge.to] = candidate_weight;
+                prev_edges[edge.to] = static_cast<CompactEdgeId>(edge_id);
+                queue.emplace_back(candidate_weight, edge.to);
+                std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+void Router<Weight>::RelaxRoutesThroughEdge(EdgeId edge_id) {
+    const auto& edge = graph_.GetEdge(edge_id);
+    const Weight* weights_through = weights_.data() + GetIndex(edge.to, 0);
+    const CompactEdgeId* prev_edges_through = prev_edges_.data() + GetIndex(edge.to, 0);
+    for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+        const Weight weight_from = weights_[GetIndex(vertex_from, edge.from)];
+        if (!(weight_from < INFINITE_WEIGHT)) {
+            continue;
+        }
+        const Weight weight_to = weight_from + edge.weight;
+        // Если ребро не улучшает маршрут до своего конца, то по неравенству треугольника
+        // оно не улучшает и маршруты дальше. В частности, так пропускается строка edge.to
+        if (!(weight_to < weights_[GetIndex(vertex_from, edge.to)])) {
+            continue;
+        }
+        Weight* weights_relaxing = weights_.data() + GetIndex(vertex_from, 0);
+        CompactEdgeId* prev_edges_relaxing = prev_edges_.data() + GetIndex(vertex_from, 0);
+        for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+            const Weight candidate_weight = weight_to + weights_through[vertex_to];
+            if (candidate_weight < weights_relaxing[vertex_to]) {
+                weights_relaxing[vertex_to] = candidate_weight;
+                const CompactEdgeId prev_edge_to = prev_edges_through[vertex_to];
+                prev_edges_relaxing[vertex_to] = prev_edge_to != NO_EDGE
+                                                 ? prev_edge_to
+                                                 : static_cast<CompactEdgeId>(edge_id);
+            }
+        }
+    }
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> Router<Weight>::BuildWeightsMatrix(const std::vector<VertexId>& sources,
+                                                                      const std::vector<VertexId>& targets) const {
+    std::vector<std::optional<Weight>> result;
+    result.reserve(sources.size() * targets.size());
+    for (const VertexId from : sources) {
+        for (const VertexId to : targets) {
+            if (from >= vertex_count_ || to >= vertex_count_) {
+                throw std::out_of_range("Vertex is out of graph");
+            }
+            const Weight weight = weights_[GetIndex(from, to)];
+            result.push_back(weight < INFINITE_WEIGHT ? std::optional<Weight>(weight) : std::nullopt);
+        }
+    }
+    return result;
+}
+
 }  // namespace graph
\ No newline at end of file
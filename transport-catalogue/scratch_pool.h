@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace concurrency {
+
+// Пул буферов запроса для константных методов, которые вызываются из нескольких потоков.
+// Запрос берёт свободный буфер или создаёт новый и возвращает его в пул по завершении,
+// поэтому буферов создаётся не больше, чем запросов выполнялось одновременно,
+// а в одном потоке все запросы переиспользуют один и тот же буфер
+template <typename Scratch>
+class ScratchPool {
+public:
+    using Factory = std::function<std::unique_ptr<Scratch>()>;
+
+    // Буфер, взятый из пула на время запроса
+    class Lease {
+    public:
+        Lease(const ScratchPool& pool, std::unique_ptr<Scratch> scratch)
+            : pool_(pool)
+            , scratch_(std::move(scratch)) {
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        ~Lease() {
+            pool_.Release(std::move(scratch_));
+        }
+
+        Scratch& operator*() const {
+            return *scratch_;
+        }
+
+        Scratch* operator->() const {
+            return scratch_.get();
+        }
+
+    private:
+        const ScratchPool& pool_;
+        std::unique_ptr<Scratch> scratch_;
+    };
+
+    explicit ScratchPool(Factory factory)
+        : factory_(std::move(factory)) {
+    }
+
+    Lease Acquire() const;
+
+private:
+    void Release(std::unique_ptr<Scratch> scratch) const noexcept;
+
+    Factory factory_;
+    mutable std::mutex mutex_;
+    // Место под все созданные буферы резервируется заранее, поэтому возврат в пул из деструктора Lease
+    // не выделяет память и не бросает исключений
+    mutable std::vector<std::unique_ptr<Scratch>> free_scratches_;
+    mutable size_t created_count_ = 0;
+};
+
+template <typename Scratch>
+typename ScratchPool<Scratch>::Lease ScratchPool<Scratch>::Acquire() const {
+    {
+        std::lock_guard lock(mutex_);
+        if (!free_scratches_.empty()) {
+            std::unique_ptr<Scratch> scratch = std::move(free_scratches_.back());
+            free_scratches_.pop_back();
+            return Lease(*this, std::move(scratch));
+        }
+        free_scratches_.reserve(created_count_ + 1);
+        ++created_count_;
+    }
+    // Новый буфер выделяется без блокировки, остальные потоки в это время берут свободные
+    return Lease(*this, factory_());
+}
+
+template <typename Scratch>
+void ScratchPool<Scratch>::Release(std::unique_ptr<Scratch> scratch) const noexcept {
+    std::lock_guard lock(mutex_);
+    free_scratches_.push_back(std::move(scratch));
+}
+
+}  // namespace concurrency
@@ -1,7 +1,5 @@
 #include <numeric>
-#include <set>
 #include <algorithm>
-#include <unordered_set>
 #include <stdexcept>
 
 #include "transport_catalogue.h"
@@ -16,16 +14,30 @@ void TransportCatalogue::AddBusRoute(std::string_view bus_name, const std::vecto
         }
         route.push_back(stops_[stop]);
     }
-    buses_catalog_.push_back(Bus{std::string(bus_name), std::move(route), is_roundtrip});
-    buses_.insert({buses_catalog_.back().name, &buses_catalog_.back()});
+    buses_catalog_.push_back(Bus{std::string(bus_name), std::move(route), is_roundtrip,
+                                 buses_catalog_.size()});
+    const Bus &bus = buses_catalog_.back();
+    if (!buses_.insert({bus.name, &bus}).second) {
+        return;
+    }
+    for (const Stop *stop_ptr: bus.route) {
+        auto &stop_buses = stops_buses_[stop_ptr->index];
+        const auto it = std::lower_bound(stop_buses.begin(), stop_buses.end(), std::string_view(bus.name));
+        if (it == stop_buses.end() || *it != bus.name) {
+            stop_buses.insert(it, bus.name);
+        }
+    }
+    UpdateBusStats(&bus);
 }
 
 void TransportCatalogue::AddStop(std::string_view stop_name, const geo::Coordinates &coordinates) {
     if (stops_.count(stop_name) == 0) {
-        stops_catalog_.push_back(Stop{std::string(stop_name), coordinates});
+        stops_catalog_.push_back(Stop{std::string(stop_name), coordinates, stops_catalog_.size()});
         stops_[stops_catalog_.back().name] = &stops_catalog_.back();
+        stops_buses_.emplace_back();
     } else {
         const_cast<Stop *>(stops_[stop_name])->coordinates = coordinates;
+        UpdateBusesStatsOfStop(stops_[stop_name]);
     }
 }
 
@@ -43,24 +55,64 @@ const Stop *TransportCatalogue::GetStop(std::string_view stop_name) const {
     return nullptr;
 }
 
-size_t TransportCatalogue::GetNumberStopsOfBus(const Bus *bus_ptr) const {
-    return bus_ptr->route.size();
+void TransportCatalogue::ComputeBusesStats() {
+    are_buses_stats_computed_ = true;
+    for (const auto &[_, bus_ptr]: buses_) {
+        UpdateBusStats(bus_ptr);
+    }
 }
 
-size_t TransportCatalogue::GetNumberUniqueStopsOfBus(const Bus *bus_ptr) const {
-    std::unordered_set<std::string_view> unique_stops;
-    for (const auto &stop_ptr: bus_ptr->route) {
-        unique_stops.insert(stop_ptr->name);
+BusStats TransportCatalogue::GetBusStats(const Bus *bus_ptr) const {
+    if (bus_ptr->index < buses_stats_.size() && buses_stats_[bus_ptr->index].has_value()) {
+        return *buses_stats_[bus_ptr->index];
     }
-    return unique_stops.size();
+    // Без нужного расстояния ComputeBusStats бросает std::out_of_range, как и до предварительного расчёта
+    return ComputeBusStats(bus_ptr);
+}
+
+BusStats TransportCatalogue::ComputeBusStats(const Bus *bus_ptr) const {
+    const int route_length = GetFactLength(bus_ptr);
+    const double geo_length = GetStraightLength(bus_ptr);
+    return BusStats{bus_ptr->route.size(), GetNumberUniqueStopsOfBus(bus_ptr), route_length, geo_length,
+                    route_length / geo_length};
+}
+
+void TransportCatalogue::UpdateBusStats(const Bus *bus_ptr) {
+    if (!are_buses_stats_computed_) {
+        return;
+    }
+    if (buses_stats_.size() <= bus_ptr->index) {
+        buses_stats_.resize(buses_catalog_.size());
+    }
+    try {
+        buses_stats_[bus_ptr->index] = ComputeBusStats(bus_ptr);
+    } catch (const std::out_of_range &) {
+        // Расстояние между какими-то остановками маршрута ещё не задано
+        buses_stats_[bus_ptr->index].reset();
+    }
+}
+
+void TransportCatalogue::UpdateBusesStatsOfStop(const Stop *stop_ptr) {
+    if (!are_buses_stats_computed_ || stop_ptr == nullptr) {
+        return;
+    }
+    for (const std::string_view bus_name: stops_buses_[stop_ptr->index]) {
+        UpdateBusStats(buses_.at(bus_name));
+    }
+}
+
+size_t TransportCatalogue::GetNumberUniqueStopsOfBus(const Bus *bus_ptr) const {
+    std::vector<const Stop *> unique_stops = bus_ptr->route;
+    std::sort(unique_stops.begin(), unique_stops.end());
+    return std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin();
 }
 
 double TransportCatalogue::GetStraightLength(const Bus *bus_ptr) const {
-    const auto it_begin = bus_ptr->route.begin();
-    const auto it_end = bus_ptr->route.end();
+    const auto &route = bus_ptr->route;
     double result = 0;
-    for (auto it = it_begin; it + 1 != it_end; ++it) {
-        result += geo::ComputeDistance((*it)->coordinates, (*(it + 1))->coordinates);
+    // У маршрута без остановок нет ни одного перегона
+    for (size_t i = 1; i < route.size(); ++i) {
+        result += geo::ComputeDistance(route[i - 1]->coordinates, route[i]->coordinates);
     }
     return result;
 }
@@ -68,6 +120,8 @@ double TransportCatalogue::GetStraightLength(const Bus *bus_ptr) const {
 void TransportCatalogue::SetStopsDistance(const std::string_view stop1, const std::string_view stop2,
                                           const int distance) {
     distances_[std::pair{stops_[stop1], stops_[stop2]}] = distance;
+    // Расстояние входит только в маршруты, проходящие через обе остановки
+    UpdateBusesStatsOfStop(stops_[stop1]);
 }
 
 int TransportCatalogue::GetDistance(const Stop *stop_ptr_1, const Stop *stop_ptr_2) const {
@@ -90,29 +144,16 @@ const BusesType &TransportCatalogue::GetBuses() const {
 }
 
 int TransportCatalogue::GetFactLength(const Bus *bus_ptr) const {
-    const auto it_begin = bus_ptr->route.begin();
-    const auto it_end = bus_ptr->route.end();
+    const auto &route = bus_ptr->route;
     int result = 0;
-    for (auto it = it_begin; it + 1 != it_end; ++it) {
-        if (distances_.count({*it, *(it + 1)}) > 0) {
-            result += distances_.at({*it, *(it + 1)});
-        } else {
-            result += distances_.at({*(it + 1), *it});
-        }
+    for (size_t i = 1; i < route.size(); ++i) {
+        result += GetDistance(route[i - 1], route[i]);
     }
     return result;
 }
 
-std::set<std::string_view> TransportCatalogue::GetBusesByStop(const Stop *stop_ptr_arg) const {
-    std::set<std::string_view> buses;
-    for (auto &[bus_name, bus_ptr]: buses_) {
-        for (const auto stop_ptr: bus_ptr->route) {
-            if (stop_ptr == stop_ptr_arg) {
-                buses.insert(bus_name);
-            }
-        }
-    }
-    return buses;
+BusNamesRange TransportCatalogue::GetBusesByStop(const Stop *stop_ptr) const {
+    return ranges::AsRange(stops_buses_[stop_ptr->index]);
 }
 
 std::vector<geo::Coordinates> TransportCatalogue::GetAllCoordinates() const {
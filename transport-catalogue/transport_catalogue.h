@@ -1,13 +1,14 @@
 #pragma once
 
 #include <deque>
-#include <set>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <optional>
 
 #include "domain.h"
+#include "ranges.h"
 
 namespace data {
 
@@ -16,6 +17,7 @@ namespace data {
     using SortedBusesType = std::map<std::string_view, const Bus*>;
     using SortedStopsType = std::map<std::string_view, const Stop*>;
     using DistanceType = std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopsHasher>;
+    using BusNamesRange = ranges::Range<std::vector<std::string_view>::const_iterator>;
 
 class TransportCatalogue {
     // Реализуйте класс самостоятельно
@@ -43,17 +45,17 @@ public:
 
     const Stop* GetStop(std::string_view stop_name) const;
 
-    size_t GetNumberStopsOfBus(const Bus *bus_ptr) const;
+    // Считает характеристики всех маршрутов, вызывается после загрузки базы. После этого AddBusRoute,
+    // AddStop и SetStopsDistance сразу пересчитывают характеристики затронутых маршрутов
+    void ComputeBusesStats();
 
-    size_t GetNumberUniqueStopsOfBus(const Bus *bus_ptr) const;
+    // Посчитанные характеристики маршрута; до ComputeBusesStats или без нужного расстояния считаются заново
+    BusStats GetBusStats(const Bus *bus_ptr) const;
 
     std::vector<geo::Coordinates> GetAllCoordinates() const;
 
-    double GetStraightLength(const Bus *bus_ptr) const;
-
-    int GetFactLength(const Bus *bus_ptr) const;
-
-    std::set<std::string_view> GetBusesByStop(const Stop *stop_ptr_arg) const;
+    // Названия автобусов, проходящих через остановку, по возрастанию
+    BusNamesRange GetBusesByStop(const Stop *stop_ptr) const;
 
 private:
     std::deque<Stop> stops_catalog_;
@@ -61,5 +63,23 @@ private:
     StopsType stops_;
     BusesType buses_;
     DistanceType distances_;
+    // Отсортированные названия автобусов остановки по её номеру Stop::index
+    std::vector<std::vector<std::string_view>> stops_buses_;
+    // Посчитанные характеристики маршрутов по номеру Bus::index
+    std::vector<std::optional<BusStats>> buses_stats_;
+    bool are_buses_stats_computed_ = false;
+
+    BusStats ComputeBusStats(const Bus *bus_ptr) const;
+
+    size_t GetNumberUniqueStopsOfBus(const Bus *bus_ptr) const;
+
+    double GetStraightLength(const Bus *bus_ptr) const;
+
+    int GetFactLength(const Bus *bus_ptr) const;
+
+    // Пересчитывает характеристики маршрута, если они уже были посчитаны ComputeBusesStats
+    void UpdateBusStats(const Bus *bus_ptr);
+
+    void UpdateBusesStatsOfStop(const Stop *stop_ptr);
 };
 } // namespace data
\ No newline at end of file
@@ -1,60 +1,819 @@
 #include "transport_router.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 
 router::TransportCatalogueRouter::TransportCatalogueRouter(const data::TransportCatalogue &catalogue, const request::RoutingSettings& routing_settings)
     : catalogue_(catalogue)
-      , graph_(catalogue_.GetStopsCount() * 2)
       , routing_settings_(routing_settings)
-      , bus_velocity_(routing_settings_.bus_velocity * METERS_IN_KILOMETER / MINUTES_IN_HOUR) {
+      , bus_velocity_(routing_settings_.bus_velocity * METERS_IN_KILOMETER / MINUTES_IN_HOUR)
+      , route_cache_(routing_settings_.route_cache_size) {
+    if (routing_settings_.router_engine == request::RouterEngineType::RAPTOR) {
+        // RAPTOR работает прямо по маршрутам каталога, граф ему не нужен
+        raptor_router_ = std::make_unique<RaptorRouter>(catalogue_, bus_velocity_,
+                                                         routing_settings_.bus_wait_time * 1.0);
+        return;
+    }
+    FindPassThroughStops();
+    graph_ = graph::DirectedWeightedGraph<double>(CountVertexes());
+    vertexes_stops_.resize(graph_.GetVertexCount(), nullptr);
+    stops_vertexes_.resize(catalogue_.GetStopsCount());
+    stops_visits_.resize(catalogue_.GetStopsCount());
     CreateVertexes();
     CreateEdges();
-    router_ = std::make_unique<graph::Router<double> >(graph_);
+    if (routing_settings_.reorder_vertexes) {
+        ReorderVertexes();
+    }
+    CreateGraphEdges();
+    graph_.Freeze();
+    CreateRouter();
 }
 
-std::optional<request::StatRouteInfo> router::TransportCatalogueRouter::BuildRoute(const std::string_view from, const std::string_view to) {
+std::optional<request::StatRouteInfo> router::TransportCatalogueRouter::BuildRoute(const std::string_view from, const std::string_view to) const {
     const auto from_ptr = catalogue_.GetStop(from);
     const auto to_ptr = catalogue_.GetStop(to);
-    if (stops_vertexes_.count(from_ptr) == 0 || stops_vertexes_.count(to_ptr) == 0) {
+    if (from_ptr == nullptr || to_ptr == nullptr) {
         return std::nullopt;
     }
-    const auto route = router_->BuildRoute(stops_vertexes_[from_ptr].portal, stops_vertexes_[to_ptr].portal);
-    request::StatRouteInfo result;
-    if (!route.has_value()) {
-        return std::nullopt;
+    // Без кэша запрос не берёт общий мьютекс и не копирует ответ
+    if (!IsRouteCacheEnabled()) {
+        return BuildRouteUncached(from, to);
+    }
+    const std::pair key{from_ptr, to_ptr};
+    {
+        std::lock_guard lock(route_cache_mutex_);
+        if (const auto cached_route = route_cache_.Find(key)) {
+            return *cached_route;
+        }
+    }
+    // Поиск идёт без блокировки, одну пару одновременно могут посчитать несколько потоков
+    auto route = BuildRouteUncached(from, to);
+    std::lock_guard lock(route_cache_mutex_);
+    route_cache_.Put(key, route);
+    return route;
+}
+
+std::vector<std::optional<request::StatRouteInfo> > router::TransportCatalogueRouter::BuildRoutes(
+    const std::string_view from, const std::vector<std::string_view> &stops_to) const {
+    std::vector<std::optional<request::StatRouteInfo> > result(stops_to.size());
+    const auto from_ptr = catalogue_.GetStop(from);
+    if (from_ptr == nullptr) {
+        return result;
+    }
+    // Движку передаются только пары, которых нет в кэше, каждая по одному разу
+    std::vector<std::string_view> missed_stops;
+    std::vector<const data::Stop *> missed_stops_ptrs;
+    std::unordered_map<const data::Stop *, size_t> missed_indexes;
+    std::vector<std::pair<size_t, size_t> > missed_positions;
+    const bool is_cache_enabled = IsRouteCacheEnabled();
+    std::unique_lock lock(route_cache_mutex_, std::defer_lock);
+    if (is_cache_enabled) {
+        lock.lock();
+    }
+    for (size_t i = 0; i < stops_to.size(); ++i) {
+        const auto to_ptr = catalogue_.GetStop(stops_to[i]);
+        if (to_ptr == nullptr) {
+            continue;
+        }
+        if (is_cache_enabled) {
+            if (const auto cached_route = route_cache_.Find({from_ptr, to_ptr})) {
+                result[i] = *cached_route;
+                continue;
+            }
+        }
+        const auto [it, is_inserted] = missed_indexes.emplace(to_ptr, missed_stops.size());
+        if (is_inserted) {
+            missed_stops.push_back(stops_to[i]);
+            missed_stops_ptrs.push_back(to_ptr);
+        }
+        missed_positions.emplace_back(i, it->second);
+    }
+    if (is_cache_enabled) {
+        lock.unlock();
+    }
+    auto routes = BuildRoutesUncached(from, missed_stops);
+    if (is_cache_enabled) {
+        lock.lock();
+        for (size_t i = 0; i < routes.size(); ++i) {
+            route_cache_.Put({from_ptr, missed_stops_ptrs[i]}, routes[i]);
+        }
+        lock.unlock();
     }
-    for (const auto &edge_id: route->edges) {
-        if (edges_[edge_id].stop_from_ptr == edges_[edge_id].stop_to_ptr) {
-            result.route.emplace_back(request::Route{
-                true, edges_[edge_id].stop_from_ptr, nullptr, graph_.GetEdge(edge_id).weight, 0});
+    // Ответ копируется только для повторяющихся остановок, в последнюю позицию он переносится
+    std::vector<size_t> uses_left(routes.size(), 0);
+    for (const auto &[_, missed_index]: missed_positions) {
+        ++uses_left[missed_index];
+    }
+    for (const auto &[position, missed_index]: missed_positions) {
+        if (--uses_left[missed_index] == 0) {
+            result[position] = std::move(routes[missed_index]);
         } else {
-            result.route.emplace_back(request::Route{false, nullptr, edges_[edge_id].bus_ptr, graph_.GetEdge(edge_id).weight, edges_[edge_id].span_count});
+            result[position] = routes[missed_index];
+        }
+    }
+    return result;
+}
+
+bool router::TransportCatalogueRouter::IsRouteCacheEnabled() const {
+    return routing_settings_.route_cache_size > 0;
+}
+
+cache::CacheStats router::TransportCatalogueRouter::GetRouteCacheStats() const {
+    std::lock_guard lock(route_cache_mutex_);
+    return route_cache_.GetStats();
+}
+
+size_t router::TransportCatalogueRouter::GetPrunedEdgeCount() const {
+    return pruned_edge_count_;
+}
+
+std::optional<request::StatRouteInfo> router::TransportCatalogueRouter::BuildRouteUncached(const std::string_view from,
+                                                                                          const std::string_view to) const {
+    if (raptor_router_) {
+        return raptor_router_->BuildRoute(from, to);
+    }
+    return std::move(BuildRoutesUncached(from, {to}).front());
+}
+
+std::vector<std::optional<request::StatRouteInfo> > router::TransportCatalogueRouter::BuildRoutesUncached(
+    const std::string_view from, const std::vector<std::string_view> &stops_to) const {
+    std::vector<std::optional<request::StatRouteInfo> > result(stops_to.size());
+    if (raptor_router_) {
+        for (size_t i = 0; i < stops_to.size(); ++i) {
+            result[i] = raptor_router_->BuildRoute(from, stops_to[i]);
+        }
+        return result;
+    }
+    const auto from_ptr = catalogue_.GetStop(from);
+    if (from_ptr == nullptr) {
+        return result;
+    }
+    const auto departures = GetDepartures(from_ptr);
+    // В движок передаются вершины прибытия известных остановок, ответы раскладываются обратно по позициям
+    std::vector<graph::VertexId> targets;
+    std::vector<std::pair<size_t, StopAccess> > arrivals;
+    for (size_t i = 0; i < stops_to.size() && !departures.empty(); ++i) {
+        const auto to_ptr = catalogue_.GetStop(stops_to[i]);
+        if (to_ptr == nullptr) {
+            continue;
+        }
+        if (to_ptr == from_ptr) {
+            result[i] = request::StatRouteInfo{0, {}};
+            continue;
+        }
+        for (const StopAccess &arrival: GetArrivals(to_ptr)) {
+            targets.push_back(arrival.vertex);
+            arrivals.emplace_back(i, arrival);
+        }
+    }
+    // У сквозной остановки несколько вершин отправления и прибытия, выбирается лучшее их сочетание
+    const auto update_result = [&result](size_t position, double weight, const auto &make_route) {
+        if (!result[position].has_value() || weight < result[position]->weight) {
+            result[position] = make_route();
+        }
+    };
+    for (const StopAccess &departure: departures) {
+        const double departure_weight = GetDepartureWeight(departure);
+        const auto routes = router_->BuildRoutes(departure.vertex, targets);
+        for (size_t k = 0; k < routes.size(); ++k) {
+            const auto &[position, arrival] = arrivals[k];
+            if (routes[k].has_value()) {
+                update_result(position, departure_weight + routes[k]->weight + GetArrivalWeight(arrival), [&] {
+                    return MakeStatRouteInfo(departure, *routes[k], arrival);
+                });
+            }
+            if (const auto weight = GetDirectRideWeight(departure, arrival)) {
+                update_result(position, *weight, [&] {
+                    return MakeDirectRideInfo(departure, arrival);
+                });
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<std::optional<double> > router::TransportCatalogueRouter::BuildMatrix(
+    const std::vector<std::string_view> &origins, const std::vector<std::string_view> &destinations) const {
+    std::vector<std::optional<double> > result(origins.size() * destinations.size());
+    if (raptor_router_) {
+        for (size_t i = 0; i < origins.size(); ++i) {
+            for (size_t j = 0; j < destinations.size(); ++j) {
+                if (const auto route = raptor_router_->BuildRoute(origins[i], destinations[j])) {
+                    result[i * destinations.size() + j] = route->weight;
+                }
+            }
+        }
+        return result;
+    }
+    // Движку передаются вершины известных остановок, веса раскладываются обратно по позициям
+    std::vector<const data::Stop *> origins_stops(origins.size());
+    std::vector<graph::VertexId> sources;
+    std::vector<std::pair<size_t, StopAccess> > departures;
+    for (size_t i = 0; i < origins.size(); ++i) {
+        if ((origins_stops[i] = catalogue_.GetStop(origins[i]))) {
+            for (const StopAccess &departure: GetDepartures(origins_stops[i])) {
+                sources.push_back(departure.vertex);
+                departures.emplace_back(i, departure);
+            }
+        }
+    }
+    std::vector<const data::Stop *> destinations_stops(destinations.size());
+    std::vector<graph::VertexId> targets;
+    std::vector<std::pair<size_t, StopAccess> > arrivals;
+    for (size_t j = 0; j < destinations.size(); ++j) {
+        if ((destinations_stops[j] = catalogue_.GetStop(destinations[j]))) {
+            for (const StopAccess &arrival: GetArrivals(destinations_stops[j])) {
+                targets.push_back(arrival.vertex);
+                arrivals.emplace_back(j, arrival);
+            }
+        }
+    }
+    const auto weights = router_->BuildWeightsMatrix(sources, targets);
+    const auto update_result = [&result](size_t index, double weight) {
+        if (!result[index].has_value() || weight < *result[index]) {
+            result[index] = weight;
+        }
+    };
+    for (size_t k = 0; k < departures.size(); ++k) {
+        const auto &[i, departure] = departures[k];
+        const double departure_weight = GetDepartureWeight(departure);
+        for (size_t l = 0; l < arrivals.size(); ++l) {
+            const auto &[j, arrival] = arrivals[l];
+            const size_t index = i * destinations.size() + j;
+            if (origins_stops[i] == destinations_stops[j]) {
+                result[index] = 0;
+                continue;
+            }
+            if (const auto &weight = weights[k * targets.size() + l]) {
+                update_result(index, departure_weight + *weight + GetArrivalWeight(arrival));
+            }
+            if (const auto weight = GetDirectRideWeight(departure, arrival)) {
+                update_result(index, *weight);
+            }
         }
     }
-    result.weight = route->weight;
     return result;
 }
 
+std::optional<std::vector<request::ReachableStop> > router::TransportCatalogueRouter::BuildIsochrone(
+    const std::string_view from, const double max_time) const {
+    if (raptor_router_) {
+        return raptor_router_->BuildReachable(from, max_time);
+    }
+    const auto from_ptr = catalogue_.GetStop(from);
+    if (from_ptr == nullptr) {
+        return std::nullopt;
+    }
+    const auto departures = GetDepartures(from_ptr);
+    if (departures.empty()) {
+        return std::nullopt;
+    }
+    const graph::DijkstraRouter<double> *dijkstra_router = dynamic_cast<const graph::DijkstraRouter<double> *>(router_.get());
+    if (dijkstra_router == nullptr) {
+        std::call_once(isochrone_router_flag_, [this] {
+            isochrone_router_ = std::make_unique<graph::DijkstraRouter<double> >(graph_);
+        });
+        dijkstra_router = isochrone_router_.get();
+    }
+    std::unordered_map<const data::Stop *, double> stops_weights;
+    const auto update_stop = [&stops_weights, max_time](const data::Stop *stop_ptr, double weight) {
+        if (weight > max_time) {
+            return;
+        }
+        const auto [it, is_inserted] = stops_weights.emplace(stop_ptr, weight);
+        if (!is_inserted && weight < it->second) {
+            it->second = weight;
+        }
+    };
+    update_stop(from_ptr, 0);
+    for (const StopAccess &departure: departures) {
+        if (const PassThroughVisit *visit = departure.visit) {
+            // Сквозные остановки того же участка до следующей основной достижимы без пересадок
+            for (size_t position = visit->position + 1; position < visit->next_position; ++position) {
+                update_stop(visit->bus_ptr->route[position],
+                            routing_settings_.bus_wait_time + GetRideWeight(visit->bus_ptr, visit->position, position));
+            }
+        }
+        const double departure_weight = GetDepartureWeight(departure);
+        if (departure_weight > max_time) {
+            continue;
+        }
+        for (const auto &[vertex, weight]: dijkstra_router->BuildReachable(departure.vertex, max_time - departure_weight)) {
+            // Время прибытия на основную остановку - вес до её вершины portal, на сквозную - вес до вершины
+            // "в автобусе" предыдущей основной остановки и проезд от неё
+            const double total_weight = departure_weight + weight;
+            const data::Stop *stop_ptr = vertexes_stops_[vertex];
+            if (GetStopVertexes(stop_ptr).portal == vertex) {
+                update_stop(stop_ptr, total_weight);
+            }
+            const auto visits_begin = std::lower_bound(
+                pass_through_visits_.begin(), pass_through_visits_.end(), vertex,
+                [](const PassThroughVisit &visit, graph::VertexId ride_vertex) {
+                    return visit.prev_ride_vertex < ride_vertex;
+                });
+            for (auto it = visits_begin; it != pass_through_visits_.end() && it->prev_ride_vertex == vertex; ++it) {
+                update_stop(it->bus_ptr->route[it->position], total_weight + GetArrivalWeight(StopAccess{vertex, &*it}));
+            }
+        }
+    }
+    std::vector<request::ReachableStop> result;
+    result.reserve(stops_weights.size());
+    for (const auto &[stop_ptr, weight]: stops_weights) {
+        result.push_back(request::ReachableStop{stop_ptr, weight});
+    }
+    std::sort(result.begin(), result.end(), [](const request::ReachableStop &lhs, const request::ReachableStop &rhs) {
+        return lhs.weight < rhs.weight || (lhs.weight == rhs.weight && lhs.stop->name < rhs.stop->name);
+    });
+    return result;
+}
+
+std::vector<router::TransportCatalogueRouter::StopAccess> router::TransportCatalogueRouter::GetDepartures(
+    const data::Stop *stop_ptr) const {
+    std::vector<StopAccess> result;
+    if (stops_vertexes_[stop_ptr->index].has_value()) {
+        result.push_back(StopAccess{GetStopVertexes(stop_ptr).portal, nullptr});
+    }
+    for (const size_t visit_index: stops_visits_[stop_ptr->index]) {
+        const PassThroughVisit &visit = pass_through_visits_[visit_index];
+        result.push_back(StopAccess{visit.next_ride_vertex, &visit});
+    }
+    return result;
+}
+
+std::vector<router::TransportCatalogueRouter::StopAccess> router::TransportCatalogueRouter::GetArrivals(
+    const data::Stop *stop_ptr) const {
+    std::vector<StopAccess> result;
+    if (stops_vertexes_[stop_ptr->index].has_value()) {
+        result.push_back(StopAccess{GetStopVertexes(stop_ptr).portal, nullptr});
+    }
+    for (const size_t visit_index: stops_visits_[stop_ptr->index]) {
+        const PassThroughVisit &visit = pass_through_visits_[visit_index];
+        result.push_back(StopAccess{visit.prev_ride_vertex, &visit});
+    }
+    return result;
+}
+
+double router::TransportCatalogueRouter::GetRideWeight(const data::Bus *bus_ptr, const size_t begin,
+                                                       const size_t end) const {
+    double weight = 0;
+    for (size_t position = begin; position < end; ++position) {
+        weight += GetSegmentWeight(bus_ptr->route[position], bus_ptr->route[position + 1]);
+    }
+    return weight;
+}
+
+double router::TransportCatalogueRouter::GetDepartureWeight(const StopAccess &departure) const {
+    const PassThroughVisit *visit = departure.visit;
+    if (visit == nullptr) {
+        return 0;
+    }
+    return routing_settings_.bus_wait_time + GetRideWeight(visit->bus_ptr, visit->position, visit->next_position);
+}
+
+double router::TransportCatalogueRouter::GetArrivalWeight(const StopAccess &arrival) const {
+    const PassThroughVisit *visit = arrival.visit;
+    if (visit == nullptr) {
+        return 0;
+    }
+    return GetRideWeight(visit->bus_ptr, visit->prev_position, visit->position);
+}
+
+std::optional<double> router::TransportCatalogueRouter::GetDirectRideWeight(const StopAccess &departure,
+                                                                            const StopAccess &arrival) const {
+    const PassThroughVisit *from_visit = departure.visit;
+    const PassThroughVisit *to_visit = arrival.visit;
+    if (from_visit == nullptr || to_visit == nullptr || from_visit->section_index != to_visit->section_index
+        || from_visit->position >= to_visit->position) {
+        return std::nullopt;
+    }
+    return routing_settings_.bus_wait_time + GetRideWeight(from_visit->bus_ptr, from_visit->position, to_visit->position);
+}
+
+request::StatRouteInfo router::TransportCatalogueRouter::MakeStatRouteInfo(
+    const StopAccess &departure, const graph::RouteInfo<double> &route, const StopAccess &arrival) const {
+    request::StatRouteInfo result;
+    if (const PassThroughVisit *visit = departure.visit) {
+        // Маршрут начинается посадкой на сквозной остановке и проездом до следующей основной,
+        // где поездка продолжается рёбрами RIDE или заканчивается высадкой
+        result.route.emplace_back(request::Route{true, visit->bus_ptr->route[visit->position], nullptr,
+                                                 routing_settings_.bus_wait_time * 1.0, 0});
+        result.route.emplace_back(request::Route{false, nullptr, visit->bus_ptr,
+                                                 GetRideWeight(visit->bus_ptr, visit->position, visit->next_position),
+                                                 static_cast<int>(visit->next_position - visit->position)});
+    }
+    for (const auto &edge_id: route.edges) {
+        const Edges &edge = edges_[edge_id];
+        const double weight = graph_.GetEdge(edge_id).weight;
+        switch (edge.type) {
+            case EdgeType::WAIT:
+                result.route.emplace_back(request::Route{true, edge.stop_from_ptr, nullptr, weight, 0});
+                break;
+            case EdgeType::BUS:
+                result.route.emplace_back(request::Route{false, nullptr, edge.bus_ptr, weight, edge.span_count});
+                break;
+            case EdgeType::BOARD:
+                result.route.emplace_back(request::Route{false, nullptr, edge.bus_ptr, weight, 0});
+                break;
+            case EdgeType::RIDE:
+                result.route.back().weight += weight;
+                result.route.back().span_count += edge.span_count;
+                break;
+            case EdgeType::ALIGHT:
+                break;
+        }
+    }
+    if (const PassThroughVisit *visit = arrival.visit) {
+        // Маршрут приходит в вершину "в автобусе" этого же автобуса, поездка продолжается до сквозной остановки
+        result.route.back().weight += GetArrivalWeight(arrival);
+        result.route.back().span_count += static_cast<int>(visit->position - visit->prev_position);
+    }
+    result.weight = GetDepartureWeight(departure) + route.weight + GetArrivalWeight(arrival);
+    return result;
+}
+
+request::StatRouteInfo router::TransportCatalogueRouter::MakeDirectRideInfo(const StopAccess &departure,
+                                                                            const StopAccess &arrival) const {
+    const PassThroughVisit &from_visit = *departure.visit;
+    const PassThroughVisit &to_visit = *arrival.visit;
+    const double ride_weight = GetRideWeight(from_visit.bus_ptr, from_visit.position, to_visit.position);
+    return request::StatRouteInfo{
+        routing_settings_.bus_wait_time + ride_weight,
+        {
+            request::Route{true, from_visit.bus_ptr->route[from_visit.position], nullptr,
+                           routing_settings_.bus_wait_time * 1.0, 0},
+            request::Route{false, nullptr, from_visit.bus_ptr, ride_weight,
+                           static_cast<int>(to_visit.position - from_visit.position)}
+        }
+    };
+}
+
+void router::TransportCatalogueRouter::FindPassThroughStops() {
+    const size_t stop_count = catalogue_.GetStopsCount();
+    is_pass_through_stop_.assign(stop_count, false);
+    if (routing_settings_.graph_model != request::RouterGraphModel::BUS_LINES) {
+        return;
+    }
+    // Остановка основная, если её обслуживают несколько автобусов, она на краю участка
+    // или встречается на участке несколько раз
+    std::vector<const data::Bus *> stops_buses(stop_count, nullptr);
+    std::vector<bool> is_core_stop(stop_count, false);
+    std::vector<size_t> stops_sections(stop_count, 0);
+    size_t section_number = 0;
+    for (const auto &[_, bus_ptr]: catalogue_.GetBuses()) {
+        ForEachRouteSection(bus_ptr, [&, bus_ptr = bus_ptr](size_t begin, size_t end) {
+            ++section_number;
+            for (size_t position = begin; position < end; ++position) {
+                const size_t stop_index = bus_ptr->route[position]->index;
+                if ((stops_buses[stop_index] != nullptr && stops_buses[stop_index] != bus_ptr)
+                    || position == begin || position + 1 == end || stops_sections[stop_index] == section_number) {
+                    is_core_stop[stop_index] = true;
+                }
+                stops_buses[stop_index] = bus_ptr;
+                stops_sections[stop_index] = section_number;
+            }
+        });
+    }
+    for (size_t stop_index = 0; stop_index < stop_count; ++stop_index) {
+        is_pass_through_stop_[stop_index] = stops_buses[stop_index] != nullptr && !is_core_stop[stop_index];
+    }
+}
+
+bool router::TransportCatalogueRouter::IsPassThroughStop(const data::Stop *stop_ptr) const {
+    return is_pass_through_stop_[stop_ptr->index];
+}
+
+size_t router::TransportCatalogueRouter::CountVertexes() const {
+    // Для каждой основной остановки, через которую проходит автобус, - вершины portal и hub
+    std::vector<bool> is_counted(catalogue_.GetStopsCount(), false);
+    size_t vertex_count = 0;
+    for (const auto &[_, bus_ptr]: catalogue_.GetBuses()) {
+        for (const data::Stop *stop_ptr: bus_ptr->route) {
+            if (!is_counted[stop_ptr->index] && !IsPassThroughStop(stop_ptr)) {
+                is_counted[stop_ptr->index] = true;
+                vertex_count += 2;
+            }
+        }
+    }
+    if (routing_settings_.graph_model == request::RouterGraphModel::BUS_LINES) {
+        // Вершины "в автобусе" для каждой позиции участка маршрута с основной остановкой
+        for (const auto &[_, bus_ptr]: catalogue_.GetBuses()) {
+            ForEachRouteSection(bus_ptr, [&, bus_ptr = bus_ptr](size_t begin, size_t end) {
+                vertex_count += std::count_if(bus_ptr->route.begin() + begin, bus_ptr->route.begin() + end,
+                                              [this](const data::Stop *stop_ptr) {
+                                                  return !IsPassThroughStop(stop_ptr);
+                                              });
+            });
+        }
+    }
+    return vertex_count;
+}
+
+const graph::DirectedWeightedGraph<double> &router::TransportCatalogueRouter::GetGraph() const {
+    return graph_;
+}
+
 void router::TransportCatalogueRouter::CreateVertexes() {
     graph::VertexId vertex_id = 0;
     const auto &buses = catalogue_.GetBuses();
     for (const auto &[_, bus_ptr]: buses) {
         for (auto &stop_ptr: bus_ptr->route) {
-            if (stops_vertexes_.insert(std::make_pair(stop_ptr, StopVertexes{vertex_id, vertex_id + 1})).second) {
-                auto edge_id = graph_.AddEdge({vertex_id++, vertex_id++, routing_settings_.bus_wait_time * 1.0});
-                edges_[edge_id] = Edges{bus_ptr, stop_ptr, stop_ptr, 0};
+            auto &stop_vertexes = stops_vertexes_[stop_ptr->index];
+            if (!stop_vertexes.has_value() && !IsPassThroughStop(stop_ptr)) {
+                stop_vertexes = StopVertexes{vertex_id, vertex_id + 1};
+                vertexes_stops_[vertex_id] = stop_ptr;
+                vertexes_stops_[vertex_id + 1] = stop_ptr;
+                AddEdgeOption(edge_options_, {vertex_id, vertex_id + 1, routing_settings_.bus_wait_time * 1.0},
+                        Edges{EdgeType::WAIT, bus_ptr, stop_ptr, stop_ptr, 0});
+                vertex_id += 2;
             }
         }
     }
+    next_ride_vertex_ = vertex_id;
+}
+
+const router::TransportCatalogueRouter::StopVertexes &router::TransportCatalogueRouter::GetStopVertexes(
+    const data::Stop *stop_ptr) const {
+    return *stops_vertexes_[stop_ptr->index];
+}
+
+void router::TransportCatalogueRouter::AddEdgeOption(std::vector<EdgeOption> &options,
+                                                     const graph::Edge<double> &edge, const Edges &edge_info) {
+    // Ребро графа варианту назначается в CreateGraphEdges
+    options.push_back(EdgeOption{edge, edge_info, 0});
 }
 
 void router::TransportCatalogueRouter::CreateEdges() {
-    const auto &buses = catalogue_.GetBuses();
-    for (const auto &[_, bus_ptr]: buses) {
-        if (bus_ptr->is_roundtrip) {
-            ParseBusRouteOnEdges(bus_ptr->route.begin(), bus_ptr->route.end(), bus_ptr);
-        } else {
-            const auto it_middle = bus_ptr->route.begin() + static_cast<int>(bus_ptr->route.size() / 2);
-            ParseBusRouteOnEdges(bus_ptr->route.begin(), it_middle + 1, bus_ptr);
-            ParseBusRouteOnEdges(it_middle, bus_ptr->route.end(), bus_ptr);
+    // Вершины "в автобусе" каждому участку отводятся заранее подряд, как при разборе участков по очереди.
+    // Участки разбираются параллельно и склеиваются в исходном порядке, поэтому варианты рёбер,
+    // а с ними и номера рёбер графа не зависят от числа потоков
+    const bool is_bus_lines = routing_settings_.graph_model == request::RouterGraphModel::BUS_LINES;
+    std::vector<RouteSection> sections;
+    std::vector<graph::VertexId> first_ride_vertexes;
+    graph::VertexId ride_vertex = next_ride_vertex_;
+    for (const auto &[_, bus_ptr]: catalogue_.GetBuses()) {
+        ForEachRouteSection(bus_ptr, [&, bus_ptr = bus_ptr](size_t begin, size_t end) {
+            sections.push_back(RouteSection{bus_ptr, begin, end, 0, 0});
+            first_ride_vertexes.push_back(ride_vertex);
+            if (is_bus_lines) {
+                ride_vertex += std::count_if(bus_ptr->route.begin() + begin, bus_ptr->route.begin() + end,
+                                             [this](const data::Stop *stop_ptr) {
+                                                 return !IsPassThroughStop(stop_ptr);
+                                             });
+            }
+        });
+    }
+    next_ride_vertex_ = ride_vertex;
+
+    std::vector<SectionEdges> sections_edges(sections.size());
+    ParseRouteSections(sections, first_ride_vertexes, sections_edges);
+    for (size_t section_index = 0; section_index < sections.size(); ++section_index) {
+        MergeRouteSection(sections[section_index], sections_edges[section_index]);
+        sections_edges[section_index] = SectionEdges{};
+    }
+}
+
+void router::TransportCatalogueRouter::ParseRouteSection(const RouteSection &section,
+                                                         const graph::VertexId first_ride_vertex,
+                                                         SectionEdges &section_edges) {
+    const auto route_begin = section.bus_ptr->route.begin();
+    ParseBusRoute(route_begin + section.begin, route_begin + section.end, section.bus_ptr, first_ride_vertex,
+                  section_edges);
+}
+
+void router::TransportCatalogueRouter::ParseRouteSections(const std::vector<RouteSection> &sections,
+                                                          const std::vector<graph::VertexId> &first_ride_vertexes,
+                                                          std::vector<SectionEdges> &sections_edges) {
+    // Участки пишут только в свои SectionEdges и в свои вершины vertexes_stops_.
+    // Исключение потока (например, о неизвестном расстоянии) останавливает остальных и передаётся дальше
+    concurrency::ParallelFor(sections.size(), routing_settings_.router_thread_count, [&] {
+        return [&](size_t section_index) {
+            ParseRouteSection(sections[section_index], first_ride_vertexes[section_index],
+                              sections_edges[section_index]);
+        };
+    });
+}
+
+void router::TransportCatalogueRouter::MergeRouteSection(RouteSection section, SectionEdges &section_edges) {
+    section.first_option = edge_options_.size();
+    edge_options_.insert(edge_options_.end(), section_edges.options.begin(), section_edges.options.end());
+    section.end_option = edge_options_.size();
+    for (PassThroughVisit &visit: section_edges.visits) {
+        visit.section_index = route_sections_.size();
+        stops_visits_[visit.bus_ptr->route[visit.position]->index].push_back(pass_through_visits_.size());
+        pass_through_visits_.push_back(visit);
+    }
+    route_sections_.push_back(section);
+}
+
+void router::TransportCatalogueRouter::ReorderVertexes() {
+    // Номера вершин при создании зависят от порядка автобусов в хеш-таблице каталога и с географией
+    // не связаны. Вдоль кривой Гильберта вершины одной остановки и соседних остановок получают близкие номера,
+    // и поиск по графу реже выходит за пределы кэша. Вершины одной остановки сохраняют свой порядок
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<std::uint64_t> vertexes_keys(vertex_count);
+    std::vector<graph::VertexId> order(vertex_count);
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        vertexes_keys[vertex] = geo::ComputeHilbertIndex(vertexes_stops_[vertex]->coordinates);
+        order[vertex] = vertex;
+    }
+    std::sort(order.begin(), order.end(), [this, &vertexes_keys](graph::VertexId lhs, graph::VertexId rhs) {
+        return std::tuple(vertexes_keys[lhs], vertexes_stops_[lhs]->index, lhs)
+               < std::tuple(vertexes_keys[rhs], vertexes_stops_[rhs]->index, rhs);
+    });
+    std::vector<graph::VertexId> new_vertexes(vertex_count);
+    std::vector<const data::Stop *> vertexes_stops(vertex_count);
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        new_vertexes[order[vertex]] = vertex;
+        vertexes_stops[vertex] = vertexes_stops_[order[vertex]];
+    }
+    vertexes_stops_ = std::move(vertexes_stops);
+    for (auto &stop_vertexes: stops_vertexes_) {
+        if (stop_vertexes.has_value()) {
+            stop_vertexes = StopVertexes{new_vertexes[stop_vertexes->portal], new_vertexes[stop_vertexes->hub]};
+        }
+    }
+    for (EdgeOption &option: edge_options_) {
+        option.edge.from = new_vertexes[option.edge.from];
+        option.edge.to = new_vertexes[option.edge.to];
+    }
+    // Проезды через сквозные остановки ищутся по вершине prev_ride_vertex, поэтому упорядочиваются заново
+    for (PassThroughVisit &visit: pass_through_visits_) {
+        visit.prev_ride_vertex = new_vertexes[visit.prev_ride_vertex];
+        visit.next_ride_vertex = new_vertexes[visit.next_ride_vertex];
+    }
+    std::stable_sort(pass_through_visits_.begin(), pass_through_visits_.end(),
+                     [](const PassThroughVisit &lhs, const PassThroughVisit &rhs) {
+                         return lhs.prev_ride_vertex < rhs.prev_ride_vertex;
+                     });
+    for (auto &stop_visits: stops_visits_) {
+        stop_visits.clear();
+    }
+    for (size_t visit_index = 0; visit_index < pass_through_visits_.size(); ++visit_index) {
+        const PassThroughVisit &visit = pass_through_visits_[visit_index];
+        stops_visits_[visit.bus_ptr->route[visit.position]->index].push_back(visit_index);
+    }
+}
+
+void router::TransportCatalogueRouter::CreateGraphEdges() {
+    // Автобусы с общими перегонами дают много поездок между одними и теми же вершинами,
+    // а кратчайшему пути нужна только самая быстрая из них. Рёбра графа нумеруются в порядке
+    // появления первого варианта
+    const std::uint64_t vertex_count = graph_.GetVertexCount();
+    std::unordered_map<std::uint64_t, graph::EdgeId> vertexes_edges;
+    vertexes_edges.reserve(edge_options_.size());
+    std::vector<size_t> options_counts;
+    for (EdgeOption &option: edge_options_) {
+        const std::uint64_t key = option.edge.from * vertex_count + option.edge.to;
+        const auto [it, is_inserted] = vertexes_edges.emplace(key, options_counts.size());
+        if (is_inserted) {
+            options_counts.push_back(0);
+        }
+        option.edge_id = it->second;
+        ++options_counts[option.edge_id];
+    }
+
+    const size_t edge_count = options_counts.size();
+    options_offsets_.assign(edge_count + 1, 0);
+    for (graph::EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        options_offsets_[edge_id + 1] = options_offsets_[edge_id] + options_counts[edge_id];
+    }
+    // Внутри ребра варианты идут в порядке создания
+    std::vector<size_t> positions(options_offsets_.begin(), options_offsets_.end() - 1);
+    grouped_options_.resize(edge_options_.size());
+    for (size_t option_id = 0; option_id < edge_options_.size(); ++option_id) {
+        grouped_options_[positions[edge_options_[option_id].edge_id]++] = option_id;
+    }
+
+    edges_.reserve(edge_count);
+    for (graph::EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        const EdgeOption &option = edge_options_[SelectBestOption(edge_id)];
+        graph_.AddEdge(option.edge);
+        edges_.push_back(option.info);
+    }
+    pruned_edge_count_ = edge_options_.size() - edge_count;
+}
+
+size_t router::TransportCatalogueRouter::SelectBestOption(const graph::EdgeId edge_id) const {
+    size_t best_option_id = grouped_options_[options_offsets_[edge_id]];
+    for (size_t position = options_offsets_[edge_id] + 1; position < options_offsets_[edge_id + 1]; ++position) {
+        const size_t option_id = grouped_options_[position];
+        if (edge_options_[option_id].edge.weight < edge_options_[best_option_id].edge.weight) {
+            best_option_id = option_id;
+        }
+    }
+    return best_option_id;
+}
+
+void router::TransportCatalogueRouter::UpdateStopsDistance(const std::string_view stop_from,
+                                                            const std::string_view stop_to) {
+    const data::Stop *stop_from_ptr = catalogue_.GetStop(stop_from);
+    const data::Stop *stop_to_ptr = catalogue_.GetStop(stop_to);
+    if (stop_from_ptr == nullptr || stop_to_ptr == nullptr) {
+        return;
+    }
+    route_cache_.Clear();
+    if (raptor_router_) {
+        raptor_router_->UpdateStopsDistance(stop_from_ptr, stop_to_ptr);
+        return;
+    }
+    // Если расстояние в обратную сторону не задано, каталог берёт это же, поэтому проверяются оба направления
+    const auto is_changed_segment = [stop_from_ptr, stop_to_ptr](const data::Stop *lhs, const data::Stop *rhs) {
+        return (lhs == stop_from_ptr && rhs == stop_to_ptr) || (lhs == stop_to_ptr && rhs == stop_from_ptr);
+    };
+    std::vector<graph::EdgeId> changed_edges;
+    for (const RouteSection &section: route_sections_) {
+        UpdateRouteSectionWeights(section, is_changed_segment, changed_edges);
+    }
+    ApplyEdgeWeightChanges(std::move(changed_edges));
+}
+
+void router::TransportCatalogueRouter::UpdateBusWaitTime(const int bus_wait_time) {
+    routing_settings_.bus_wait_time = bus_wait_time;
+    route_cache_.Clear();
+    if (raptor_router_) {
+        raptor_router_->SetBusWaitTime(bus_wait_time * 1.0);
+        return;
+    }
+    std::vector<graph::EdgeId> changed_edges;
+    for (size_t option_id = 0; option_id < edge_options_.size(); ++option_id) {
+        if (edge_options_[option_id].info.type == EdgeType::WAIT) {
+            SetEdgeOptionWeight(option_id, bus_wait_time * 1.0, changed_edges);
         }
     }
+    ApplyEdgeWeightChanges(std::move(changed_edges));
+}
+
+void router::TransportCatalogueRouter::UpdateBusVelocity(const double bus_velocity) {
+    routing_settings_.bus_velocity = bus_velocity;
+    bus_velocity_ = bus_velocity * METERS_IN_KILOMETER / MINUTES_IN_HOUR;
+    route_cache_.Clear();
+    if (raptor_router_) {
+        raptor_router_->SetBusVelocity(bus_velocity_);
+        return;
+    }
+    std::vector<graph::EdgeId> changed_edges;
+    for (const RouteSection &section: route_sections_) {
+        UpdateRouteSectionWeights(section, [](const data::Stop *, const data::Stop *) { return true; }, changed_edges);
+    }
+    ApplyEdgeWeightChanges(std::move(changed_edges));
+}
+
+void router::TransportCatalogueRouter::SetEdgeOptionWeight(const size_t option_id, const double weight,
+                                                           std::vector<graph::EdgeId> &changed_edges) {
+    EdgeOption &option = edge_options_[option_id];
+    if (option.edge.weight != weight) {
+        option.edge.weight = weight;
+        changed_edges.push_back(option.edge_id);
+    }
+}
+
+void router::TransportCatalogueRouter::ApplyEdgeWeightChanges(std::vector<graph::EdgeId> changed_edges) {
+    std::sort(changed_edges.begin(), changed_edges.end());
+    changed_edges.erase(std::unique(changed_edges.begin(), changed_edges.end()), changed_edges.end());
+    // Самым быстрым может стать другой вариант ребра, тогда вместе с весом меняется и описание ребра
+    std::vector<graph::EdgeWeightChange<double> > changes;
+    for (const graph::EdgeId edge_id: changed_edges) {
+        const EdgeOption &option = edge_options_[SelectBestOption(edge_id)];
+        edges_[edge_id] = option.info;
+        const double old_weight = graph_.GetEdge(edge_id).weight;
+        if (old_weight != option.edge.weight) {
+            graph_.SetEdgeWeight(edge_id, option.edge.weight);
+            changes.push_back(graph::EdgeWeightChange<double>{edge_id, old_weight});
+        }
+    }
+    if (changes.empty()) {
+        return;
+    }
+    if (!router_->UpdateEdgeWeights(changes)) {
+        CreateRouter();
+    }
+}
+
+double router::TransportCatalogueRouter::GetSegmentWeight(const data::Stop *stop_from_ptr,
+                                                         const data::Stop *stop_to_ptr) const {
+    const double weight = catalogue_.GetDistance(stop_from_ptr, stop_to_ptr) / bus_velocity_;
+    const size_t units_per_minute = routing_settings_.weight_units_per_minute;
+    if (units_per_minute == 0) {
+        return weight;
+    }
+    return std::round(weight * units_per_minute) / units_per_minute;
+}
+
+void router::TransportCatalogueRouter::CreateRouter() {
+    const size_t units_per_minute = routing_settings_.weight_units_per_minute;
+    if (units_per_minute == 0) {
+        router_ = MakeRouterEngine(graph_);
+        return;
+    }
+    // Движок считает в целых единицах. Веса графа уже округлены до единиц, так что перевод в целые
+    // только убирает погрешность сложения перегонов в весах рёбер BUS
+    router_ = std::make_unique<graph::FixedPointRouter<std::uint32_t> >(
+        graph_, static_cast<double>(units_per_minute),
+        [this](const graph::DirectedWeightedGraph<std::uint32_t> &graph) {
+            return MakeRouterEngine(graph);
+        });
 }
@@ -1,8 +1,23 @@
 #pragma once
 
+#include "astar_router.h"
+#include "contraction_hierarchies.h"
+#include "customizable_router.h"
+#include "dijkstra_router.h"
+#include "fixed_point_router.h"
+#include "hub_labels.h"
+#include "lru_cache.h"
+#include "raptor_router.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+
 using namespace std::literals;
 
 namespace router {
@@ -13,7 +28,43 @@ public:
 
     TransportCatalogueRouter(const data::TransportCatalogue &catalogue, const request::RoutingSettings& routing_settings);
 
-    std::optional<request::StatRouteInfo> BuildRoute(std::string_view from, std::string_view to);
+    // Константные методы запросов можно вызывать из нескольких потоков одновременно:
+    // у движков свои буферы поиска на каждый запрос, а кэш ответов, если он включён, защищён мьютексом.
+    // Обновления весов с запросами не совмещаются.
+
+    // Готовые ответы хранятся в LRU-кэше на routing_settings.route_cache_size пар остановок,
+    // повторный запрос той же пары не обращается к движку
+    std::optional<request::StatRouteInfo> BuildRoute(std::string_view from, std::string_view to) const;
+
+    // Маршруты из одной остановки в несколько, ответы в порядке stops_to
+    std::vector<std::optional<request::StatRouteInfo> > BuildRoutes(std::string_view from,
+                                                                    const std::vector<std::string_view> &stops_to) const;
+
+    cache::CacheStats GetRouteCacheStats() const;
+
+    // Сколько рёбер отброшено при построении графа: из параллельных рёбер между двумя вершинами
+    // в графе остаётся только самое быстрое
+    size_t GetPrunedEdgeCount() const;
+
+    // Время в пути из каждой остановки origins в каждую остановку destinations, построчно:
+    // [i * destinations.size() + j]. Пусто, если маршрута нет
+    std::vector<std::optional<double> > BuildMatrix(const std::vector<std::string_view> &origins,
+                                                    const std::vector<std::string_view> &destinations) const;
+
+    // Остановки, до которых можно добраться из from не дольше чем за max_time, в порядке возрастания времени.
+    // Пусто, если остановки нет или её не обслуживает ни один автобус
+    std::optional<std::vector<request::ReachableStop> > BuildIsochrone(std::string_view from, double max_time) const;
+
+    // Обновления без перестройки графа. UpdateStopsDistance вызывается после SetStopsDistance в каталоге:
+    // пересчитываются веса только тех рёбер, которые проходят по перегону между этими остановками
+    void UpdateStopsDistance(std::string_view stop_from, std::string_view stop_to);
+
+    void UpdateBusWaitTime(int bus_wait_time);
+
+    // bus_velocity - скорость автобуса в км/ч, пересчитываются веса всех поездок
+    void UpdateBusVelocity(double bus_velocity);
+
+    const graph::DirectedWeightedGraph<double> &GetGraph() const;
 
 private:
     struct StopVertexes {
@@ -21,44 +72,429 @@ private:
         size_t hub;
     };
 
+    // Рёбра графа:
+    // WAIT - ожидание автобуса на остановке (portal -> hub);
+    // BUS - поездка между двумя остановками одного маршрута (hub -> portal);
+    // в модели BUS_LINES вместо BUS у каждой позиции маршрута есть вершина "в автобусе",
+    // а поездка складывается из посадки (BOARD), перегонов (RIDE) и высадки (ALIGHT)
+    enum class EdgeType {
+        WAIT,
+        BUS,
+        BOARD,
+        RIDE,
+        ALIGHT
+    };
+
     struct Edges {
+        EdgeType type;
         const data::Bus *bus_ptr;
         const data::Stop *stop_from_ptr;
         const data::Stop *stop_to_ptr;
         int span_count;
     };
 
+    // Вариант ребра графа: ожидание или поездка одним автобусом. Варианты между одними и теми же
+    // вершинами сливаются в одно ребро графа edge_id с весом и описанием самого быстрого из них
+    struct EdgeOption {
+        graph::Edge<double> edge;
+        Edges info;
+        graph::EdgeId edge_id;
+    };
+
+    // Участок маршрута автобуса [begin, end) и созданные по нему варианты рёбер [first_option, end_option)
+    struct RouteSection {
+        const data::Bus *bus_ptr;
+        size_t begin;
+        size_t end;
+        size_t first_option;
+        size_t end_option;
+    };
+
+    // Проезд автобуса через сквозную остановку на позиции position маршрута. У сквозной остановки нет
+    // своих вершин, а ближайшие основные остановки участка до и после неё - на позициях
+    // prev_position и next_position с вершинами "в автобусе" prev_ride_vertex и next_ride_vertex
+    struct PassThroughVisit {
+        const data::Bus *bus_ptr;
+        size_t section_index;
+        size_t position;
+        size_t prev_position;
+        size_t next_position;
+        graph::VertexId prev_ride_vertex;
+        graph::VertexId next_ride_vertex;
+    };
+
+    // Вершина, с которой маршрут начинается или которой заканчивается на остановке: portal основной
+    // остановки или вершина "в автобусе" соседней основной остановки для проезда visit через сквозную
+    struct StopAccess {
+        graph::VertexId vertex;
+        const PassThroughVisit *visit;
+    };
+
+    // Варианты рёбер и проезды через сквозные остановки одного участка маршрута. Участки разбираются
+    // независимо друг от друга, номер участка проезду назначается при склейке в MergeRouteSection
+    struct SectionEdges {
+        std::vector<EdgeOption> options;
+        std::vector<PassThroughVisit> visits;
+    };
+
     const data::TransportCatalogue &catalogue_;
     graph::DirectedWeightedGraph<double> graph_;
     request::RoutingSettings routing_settings_;
-    std::unordered_map<const data::Stop *, StopVertexes> stops_vertexes_;
-    std::unordered_map<size_t, Edges> edges_;
-    const double bus_velocity_;
-    std::unique_ptr<graph::Router<double> > router_;
+    // Вершины остановки по её номеру Stop::index; пусто, если через остановку не проходит ни один автобус
+    std::vector<std::optional<StopVertexes> > stops_vertexes_;
+    // Описание ребра по его EdgeId - описание самого быстрого из его вариантов
+    std::vector<Edges> edges_;
+    // Варианты рёбер в порядке создания
+    std::vector<EdgeOption> edge_options_;
+    // Номера вариантов ребра графа edge_id: [options_offsets_[edge_id], options_offsets_[edge_id + 1])
+    // в grouped_options_
+    std::vector<size_t> options_offsets_;
+    std::vector<size_t> grouped_options_;
+    size_t pruned_edge_count_ = 0;
+    std::vector<const data::Stop *> vertexes_stops_;
+    std::vector<RouteSection> route_sections_;
+    // Сквозные остановки по номеру Stop::index: в модели BUS_LINES это остановки одного автобуса,
+    // которые на каждом участке его маршрута встречаются не больше раза и не на краю участка
+    std::vector<bool> is_pass_through_stop_;
+    // Проезды через сквозные остановки по возрастанию prev_ride_vertex
+    std::vector<PassThroughVisit> pass_through_visits_;
+    // Номера проездов через сквозную остановку по её номеру Stop::index
+    std::vector<std::vector<size_t> > stops_visits_;
+    graph::VertexId next_ride_vertex_ = 0;
+    // Скорость автобуса в метрах в минуту
+    double bus_velocity_;
+    std::unique_ptr<graph::RouterEngine<double> > router_;
+    std::unique_ptr<RaptorRouter> raptor_router_;
+    mutable std::mutex route_cache_mutex_;
+    mutable cache::LruCache<std::pair<const data::Stop *, const data::Stop *>, std::optional<request::StatRouteInfo>,
+        data::StopsHasher> route_cache_;
+    // Ограниченный поиск для изохрон создаётся при первом запросе, если основной движок - не Дейкстра
+    mutable std::once_flag isochrone_router_flag_;
+    mutable std::unique_ptr<graph::DijkstraRouter<double> > isochrone_router_;
+
+    // Участки маршрута автобуса: у кольцевого - весь маршрут, у некольцевого - половины туда и обратно,
+    // средняя остановка входит в обе. callback(begin, end)
+    template<typename Callback>
+    static void ForEachRouteSection(const data::Bus *bus_ptr, Callback callback);
+
+    void FindPassThroughStops();
+
+    bool IsPassThroughStop(const data::Stop *stop_ptr) const;
+
+    size_t CountVertexes() const;
 
     void CreateVertexes();
 
+    std::optional<request::StatRouteInfo> BuildRouteUncached(std::string_view from, std::string_view to) const;
+
+    // При нулевом routing_settings.route_cache_size запросы не обращаются ни к кэшу, ни к его мьютексу
+    bool IsRouteCacheEnabled() const;
+
+    std::vector<std::optional<request::StatRouteInfo> > BuildRoutesUncached(
+        std::string_view from, const std::vector<std::string_view> &stops_to) const;
+
+    const StopVertexes &GetStopVertexes(const data::Stop *stop_ptr) const;
+
+    // Вершины начала и конца маршрутов на остановке; пусто, если остановку не обслуживает ни один автобус
+    std::vector<StopAccess> GetDepartures(const data::Stop *stop_ptr) const;
+
+    std::vector<StopAccess> GetArrivals(const data::Stop *stop_ptr) const;
+
+    // Время перегонов маршрута автобуса между позициями begin и end
+    double GetRideWeight(const data::Bus *bus_ptr, size_t begin, size_t end) const;
+
+    // Ожидание на сквозной остановке и проезд от неё до вершины отправления, для основной - 0
+    double GetDepartureWeight(const StopAccess &departure) const;
+
+    // Проезд от вершины прибытия до сквозной остановки, для основной - 0
+    double GetArrivalWeight(const StopAccess &arrival) const;
+
+    // Время поездки одним автобусом между сквозными остановками без выхода в основной граф, если она возможна
+    std::optional<double> GetDirectRideWeight(const StopAccess &departure, const StopAccess &arrival) const;
+
+    request::StatRouteInfo MakeStatRouteInfo(const StopAccess &departure, const graph::RouteInfo<double> &route,
+                                             const StopAccess &arrival) const;
+
+    request::StatRouteInfo MakeDirectRideInfo(const StopAccess &departure, const StopAccess &arrival) const;
+
+    static void AddEdgeOption(std::vector<EdgeOption> &options, const graph::Edge<double> &edge,
+                              const Edges &edge_info);
+
+    // Разбирает участок в section_edges. Вершины "в автобусе" участка нумеруются подряд с first_ride_vertex,
+    // поэтому участки разных автобусов можно разбирать одновременно
+    void ParseRouteSection(const RouteSection &section, graph::VertexId first_ride_vertex,
+                           SectionEdges &section_edges);
+
+    // Разбирает участки на routing_settings_.router_thread_count потоках
+    void ParseRouteSections(const std::vector<RouteSection> &sections,
+                            const std::vector<graph::VertexId> &first_ride_vertexes,
+                            std::vector<SectionEdges> &sections_edges);
+
+    // Дописывает разобранный участок к edge_options_, route_sections_ и проездам через сквозные остановки
+    void MergeRouteSection(RouteSection section, SectionEdges &section_edges);
+
+    template<typename Iterator>
+    void ParseBusRoute(Iterator it_begin, Iterator it_end, const data::Bus *bus_ptr, graph::VertexId first_ride_vertex,
+                       SectionEdges &section_edges);
+
+    // Перебирает рёбра BUS участка маршрута в порядке их создания: callback(it_from, it_to, weight, span_count)
+    template<typename Iterator, typename Callback>
+    void ForEachBusEdge(Iterator it_begin, Iterator it_end, Callback callback) const;
+
     template<typename Iterator>
-    void ParseBusRouteOnEdges(Iterator it_begin, Iterator it_end, const data::Bus *bus_ptr);
+    void ParseBusRouteOnEdges(Iterator it_begin, Iterator it_end, const data::Bus *bus_ptr,
+                              std::vector<EdgeOption> &options) const;
+
+    template<typename Iterator>
+    void ParseBusRouteOnLine(Iterator it_begin, Iterator it_end, const data::Bus *bus_ptr,
+                             graph::VertexId first_ride_vertex, SectionEdges &section_edges);
 
     void CreateEdges();
+
+    // Перенумеровывает вершины вдоль кривой Гильберта по координатам их остановок
+    void ReorderVertexes();
+
+    // Добавляет в граф по одному ребру на каждую пару вершин, между которыми есть варианты
+    void CreateGraphEdges();
+
+    // Самый быстрый вариант ребра графа, из равных - созданный раньше
+    size_t SelectBestOption(graph::EdgeId edge_id) const;
+
+    // Время проезда перегона. При целочисленных весах оно округляется до целых единиц
+    // routing_settings_.weight_units_per_minute, поэтому суммы перегонов в обеих моделях графа совпадают
+    double GetSegmentWeight(const data::Stop *stop_from_ptr, const data::Stop *stop_to_ptr) const;
+
+    void CreateRouter();
+
+    // Движок по настройке router_engine для графа с весами Weight, для RAPTOR - пусто
+    template<typename Weight>
+    std::unique_ptr<graph::RouterEngine<Weight> > MakeRouterEngine(const graph::DirectedWeightedGraph<Weight> &graph) const;
+
+    // Метки из файла routing_settings_.hub_labels_path, если они подходят графу, иначе новые
+    template<typename Weight>
+    std::unique_ptr<graph::RouterEngine<Weight> > MakeHubLabelsRouter(const graph::DirectedWeightedGraph<Weight> &graph) const;
+
+    // Пересчитывает веса поездок участка, которые проходят по перегонам is_changed_segment(stop_from, stop_to)
+    template<typename Predicate>
+    void UpdateRouteSectionWeights(const RouteSection &section, Predicate is_changed_segment,
+                                   std::vector<graph::EdgeId> &changed_edges);
+
+    // Меняет вес варианта и запоминает ребро графа, которому принадлежит вариант
+    void SetEdgeOptionWeight(size_t option_id, double weight, std::vector<graph::EdgeId> &changed_edges);
+
+    // Выбирает заново самые быстрые варианты изменённых рёбер и передаёт новые веса движку,
+    // а если он не умеет обновляться - строит его заново
+    void ApplyEdgeWeightChanges(std::vector<graph::EdgeId> changed_edges);
+
+    // Нижняя оценка веса пути между остановками по расстоянию на сфере
+    template<typename Weight>
+    typename graph::AStarRouter<Weight>::Heuristic MakeGeoHeuristic(const graph::DirectedWeightedGraph<Weight> &graph) const;
 };
 
 template<typename Iterator>
-void TransportCatalogueRouter::ParseBusRouteOnEdges(Iterator it_begin, Iterator it_end, const data::Bus *bus_ptr) {
+void TransportCatalogueRouter::ParseBusRoute(Iterator it_begin, Iterator it_end, const data::Bus *bus_ptr,
+                                             const graph::VertexId first_ride_vertex, SectionEdges &section_edges) {
+    if (routing_settings_.graph_model == request::RouterGraphModel::BUS_LINES) {
+        ParseBusRouteOnLine(it_begin, it_end, bus_ptr, first_ride_vertex, section_edges);
+    } else {
+        ParseBusRouteOnEdges(it_begin, it_end, bus_ptr, section_edges.options);
+    }
+}
+
+template<typename Iterator, typename Callback>
+void TransportCatalogueRouter::ForEachBusEdge(Iterator it_begin, Iterator it_end, Callback callback) const {
     for (auto it_start = it_begin; it_start != it_end; ++it_start) {
         double weight = 0;
         int span_count = 0;
         for (auto it_stop = it_start + 1; it_stop != it_end; ++it_stop) {
             if (*it_start != *it_stop) {
-                weight += catalogue_.GetDistance(*(it_stop - 1), *it_stop) / bus_velocity_;
+                weight += GetSegmentWeight(*(it_stop - 1), *it_stop);
                 ++span_count;
-                auto edge_id = graph_.AddEdge({
-                    stops_vertexes_[*it_start].hub, stops_vertexes_[*it_stop].portal, weight
-                });
-                edges_[edge_id] = Edges{bus_ptr, *it_start, *it_stop, span_count};
+                callback(it_start, it_stop, weight, span_count);
+            }
+        }
+    }
+}
+
+template<typename Iterator>
+void TransportCatalogueRouter::ParseBusRouteOnEdges(Iterator it_begin, Iterator it_end, const data::Bus *bus_ptr,
+                                                    std::vector<EdgeOption> &options) const {
+    ForEachBusEdge(it_begin, it_end, [this, bus_ptr, &options](Iterator it_from, Iterator it_to, double weight,
+                                                               int span_count) {
+        AddEdgeOption(options, {GetStopVertexes(*it_from).hub, GetStopVertexes(*it_to).portal, weight},
+                Edges{EdgeType::BUS, bus_ptr, *it_from, *it_to, span_count});
+    });
+}
+
+template<typename Callback>
+void TransportCatalogueRouter::ForEachRouteSection(const data::Bus *bus_ptr, Callback callback) {
+    if (bus_ptr->route.empty()) {
+        return;
+    }
+    if (bus_ptr->is_roundtrip) {
+        callback(0, bus_ptr->route.size());
+    } else {
+        const size_t middle = bus_ptr->route.size() / 2;
+        callback(0, middle + 1);
+        callback(middle, bus_ptr->route.size());
+    }
+}
+
+template<typename Iterator>
+void TransportCatalogueRouter::ParseBusRouteOnLine(Iterator it_begin, Iterator it_end, const data::Bus *bus_ptr,
+                                                   const graph::VertexId first_ride_vertex,
+                                                   SectionEdges &section_edges) {
+    // Вершины "в автобусе" есть только у основных остановок. Перегоны через сквозные остановки
+    // сливаются в одно ребро RIDE, а проезды через них запоминаются для запросов, которые на них начинаются
+    // или заканчиваются. Края участка - всегда основные остановки
+    graph::VertexId ride_vertex = first_ride_vertex;
+    for (auto it_stop = it_begin; it_stop != it_end; ++ride_vertex) {
+        vertexes_stops_[ride_vertex] = *it_stop;
+        auto it_next = it_stop + 1;
+        // С последней остановки не уезжают, на первой не выходят
+        if (it_next != it_end) {
+            AddEdgeOption(section_edges.options, {GetStopVertexes(*it_stop).hub, ride_vertex, 0},
+                    Edges{EdgeType::BOARD, bus_ptr, *it_stop, *it_stop, 0});
+            double weight = GetSegmentWeight(*it_stop, *it_next);
+            for (; IsPassThroughStop(*it_next); ++it_next) {
+                weight += GetSegmentWeight(*it_next, *(it_next + 1));
+            }
+            for (auto it_visit = it_stop + 1; it_visit != it_next; ++it_visit) {
+                section_edges.visits.push_back(PassThroughVisit{
+                    bus_ptr, 0, static_cast<size_t>(it_visit - bus_ptr->route.begin()),
+                    static_cast<size_t>(it_stop - bus_ptr->route.begin()),
+                    static_cast<size_t>(it_next - bus_ptr->route.begin()), ride_vertex, ride_vertex + 1});
+            }
+            AddEdgeOption(section_edges.options, {ride_vertex, ride_vertex + 1, weight},
+                    Edges{EdgeType::RIDE, bus_ptr, *it_stop, *it_next, static_cast<int>(it_next - it_stop)});
+        }
+        if (it_stop != it_begin) {
+            AddEdgeOption(section_edges.options, {ride_vertex, GetStopVertexes(*it_stop).portal, 0},
+                    Edges{EdgeType::ALIGHT, bus_ptr, *it_stop, *it_stop, 0});
+        }
+        it_stop = it_next;
+    }
+}
+
+template<typename Predicate>
+void TransportCatalogueRouter::UpdateRouteSectionWeights(const RouteSection &section, Predicate is_changed_segment,
+                                                         std::vector<graph::EdgeId> &changed_edges) {
+    const auto &route = section.bus_ptr->route;
+    bool is_affected = false;
+    for (size_t position = section.begin; position + 1 < section.end && !is_affected; ++position) {
+        is_affected = is_changed_segment(route[position], route[position + 1]);
+    }
+    if (!is_affected) {
+        return;
+    }
+    if (routing_settings_.graph_model == request::RouterGraphModel::BUS_LINES) {
+        // Ребро RIDE проходит span_count перегонов подряд, рёбра RIDE участка идут в порядке маршрута
+        size_t position = section.begin;
+        for (size_t option_id = section.first_option; option_id < section.end_option; ++option_id) {
+            const Edges &edge = edge_options_[option_id].info;
+            if (edge.type != EdgeType::RIDE) {
+                continue;
+            }
+            double weight = 0;
+            bool is_changed = false;
+            for (const size_t end = position + edge.span_count; position < end; ++position) {
+                weight += GetSegmentWeight(route[position], route[position + 1]);
+                is_changed = is_changed || is_changed_segment(route[position], route[position + 1]);
+            }
+            if (is_changed) {
+                SetEdgeOptionWeight(option_id, weight, changed_edges);
             }
         }
+    } else {
+        // Вес поездки BUS - сумма перегонов, поэтому веса участка пересчитываются целиком в порядке создания вариантов
+        size_t option_id = section.first_option;
+        ForEachBusEdge(route.begin() + section.begin, route.begin() + section.end,
+                       [&](auto, auto, double weight, int) {
+                           SetEdgeOptionWeight(option_id++, weight, changed_edges);
+                       });
     }
 }
+
+template<typename Weight>
+std::unique_ptr<graph::RouterEngine<Weight> > TransportCatalogueRouter::MakeRouterEngine(
+    const graph::DirectedWeightedGraph<Weight> &graph) const {
+    switch (routing_settings_.router_engine) {
+        case request::RouterEngineType::ALL_PAIRS:
+            return std::make_unique<graph::Router<Weight> >(graph, routing_settings_.router_thread_count);
+        case request::RouterEngineType::DIJKSTRA:
+            return std::make_unique<graph::DijkstraRouter<Weight> >(graph);
+        case request::RouterEngineType::CONTRACTION_HIERARCHIES:
+            return std::make_unique<graph::ContractionHierarchiesRouter<Weight> >(graph);
+        case request::RouterEngineType::A_STAR:
+            return std::make_unique<graph::AStarRouter<Weight> >(graph, MakeGeoHeuristic(graph));
+        case request::RouterEngineType::ALT: {
+            // Ориентиры живут, пока жива оценка, которая на них ссылается
+            auto landmarks = std::make_shared<const graph::Landmarks<Weight> >(graph, routing_settings_.landmark_count);
+            return std::make_unique<graph::AStarRouter<Weight> >(
+                graph, [landmarks = std::move(landmarks)](graph::VertexId vertex, graph::VertexId target) {
+                    return landmarks->GetLowerBound(vertex, target);
+                });
+        }
+        case request::RouterEngineType::HUB_LABELS:
+            return MakeHubLabelsRouter(graph);
+        case request::RouterEngineType::CUSTOMIZABLE_ROUTE_PLANNING:
+            return std::make_unique<graph::CustomizableRouter<Weight> >(graph, routing_settings_.router_thread_count);
+        case request::RouterEngineType::RAPTOR:
+            break;
+    }
+    return nullptr;
+}
+
+template<typename Weight>
+std::unique_ptr<graph::RouterEngine<Weight> > TransportCatalogueRouter::MakeHubLabelsRouter(
+    const graph::DirectedWeightedGraph<Weight> &graph) const {
+    const std::string &path = routing_settings_.hub_labels_path;
+    if (path.empty()) {
+        return std::make_unique<graph::HubLabelsRouter<Weight> >(graph);
+    }
+    if (std::ifstream input(path, std::ios::binary); input) {
+        try {
+            return std::make_unique<graph::HubLabelsRouter<Weight> >(graph, input);
+        } catch (const std::runtime_error &) {
+            // Метки устарели или построены для другого графа
+        }
+    }
+    auto router = std::make_unique<graph::HubLabelsRouter<Weight> >(graph);
+    if (std::ofstream output(path, std::ios::binary); output) {
+        router->SaveLabels(output);
+    }
+    return router;
+}
+
+template<typename Weight>
+typename graph::AStarRouter<Weight>::Heuristic TransportCatalogueRouter::MakeGeoHeuristic(
+    const graph::DirectedWeightedGraph<Weight> &graph) const {
+    // Дорожное расстояние может быть короче расстояния на сфере, поэтому оценка умножается
+    // на наименьшее по всем поездкам отношение веса ребра к расстоянию на сфере между его остановками.
+    // Тогда по неравенству треугольника она не превышает вес любого пути между остановками
+    double min_weight_ratio = std::numeric_limits<double>::infinity();
+    for (graph::EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const Edges &edge = edges_[edge_id];
+        if ((edge.type != EdgeType::BUS && edge.type != EdgeType::RIDE) || edge.stop_from_ptr == edge.stop_to_ptr) {
+            continue;
+        }
+        const double geo_distance = geo::ComputeDistance(edge.stop_from_ptr->coordinates,
+                                                         edge.stop_to_ptr->coordinates);
+        if (geo_distance > 0) {
+            min_weight_ratio = std::min(min_weight_ratio, static_cast<double>(graph.GetEdge(edge_id).weight) / geo_distance);
+        }
+    }
+    if (std::isinf(min_weight_ratio)) {
+        min_weight_ratio = 0;
+    }
+    // Запас на погрешность вычислений с плавающей точкой
+    const double weight_per_meter = min_weight_ratio * (1 - 1e-9);
+
+    return [this, weight_per_meter](graph::VertexId vertex, graph::VertexId target) {
+        const double distance = geo::ComputeDistance(vertexes_stops_[vertex]->coordinates,
+                                                     vertexes_stops_[target]->coordinates);
+        // Для целых весов дробная часть отбрасывается, и оценка остаётся допустимой
+        return std::isnan(distance) ? Weight{} : static_cast<Weight>(distance * weight_per_meter);
+    };
+}
 } // namespace router